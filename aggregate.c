@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "records.h"
+#include "aggregate.h"
+
+/* 
+reset an aggregate to the aggregate of no footpath
+*/
+void empty_aggregate(nodeAggregate_t *aggregate) {
+  memset(aggregate, 0, sizeof(nodeAggregate_t));
+  aggregate->min_shared_depth = SHARED_LEAF;
+}
+
+/* 
+return the band of the grade1in histogram the given grade1in falls into
+*/
+int grade_band(double gradelin) {
+  if (gradelin <= 0) {
+    return 0;
+  }
+  if (gradelin < STEEP_GRADE) {
+    return 1;
+  }
+  if (gradelin < RAMP_GRADE) {
+    return 2;
+  }
+  if (gradelin < GENTLE_GRADE) {
+    return 3;
+  }
+  return 4;
+}
+
+/* 
+add (sign == 1) or remove (sign == -1) the footpath with the given record id to/from the aggregate
+*/
+void add_record_to_aggregate(nodeAggregate_t *aggregate, recordStore_t *records, uint32_t id, int sign) {
+  aggregate->footpaths += sign;
+  aggregate->distance += sign * records->distance[id];
+  aggregate->deltaz += sign * records->deltaz[id];
+  aggregate->grade_bands[grade_band(records->gradelin[id])] += sign;
+}
+
+/* 
+add the footpaths of other to the aggregate (min_shared_depth is left unchanged)
+*/
+void add_aggregate(nodeAggregate_t *aggregate, nodeAggregate_t *other) {
+  aggregate->footpaths += other->footpaths;
+  aggregate->distance += other->distance;
+  aggregate->deltaz += other->deltaz;
+  for (int band = 0; band < GRADE_BANDS; band ++) {
+    aggregate->grade_bands[band] += other->grade_bands[band];
+  }
+}
+
+/* 
+print the aggregate of a query in the format of the output file
+*/
+void print_aggregate(FILE *output, nodeAggregate_t *aggregate) {
+  /* the sums of an empty result can be left at a rounding error by removed footpaths */
+  double distance = (aggregate->footpaths > 0) ? aggregate->distance : 0.0;
+  double mean_deltaz = (aggregate->footpaths > 0) ? aggregate->deltaz / aggregate->footpaths : 0.0;
+  fprintf(output, "--> footpaths: %d || distance: %.2lf || mean deltaz: %.2lf || grade1in unknown: %d || grade1in <%d: %d"
+  " || grade1in %d-%d: %d || grade1in %d-%d: %d || grade1in >=%d: %d\n", aggregate->footpaths, distance, 
+  mean_deltaz, aggregate->grade_bands[0], STEEP_GRADE, aggregate->grade_bands[1], STEEP_GRADE, RAMP_GRADE, 
+  aggregate->grade_bands[2], RAMP_GRADE, GENTLE_GRADE, aggregate->grade_bands[3], GENTLE_GRADE, aggregate->grade_bands[4]);
+}
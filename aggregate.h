@@ -0,0 +1,48 @@
+#ifndef _AGGREGATE_H_
+#define _AGGREGATE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* bands of the grade1in histogram: unknown (0), steeper than 1 in 14, 1 in 14 to 1 in 20, 1 in 20 to 1 in 33, 
+flatter than 1 in 33 */
+#define GRADE_BANDS 5
+#define STEEP_GRADE 14
+#define RAMP_GRADE 20
+#define GENTLE_GRADE 33
+/* shared_depth of an end point that shares its leaf node with its start point */
+#define SHARED_LEAF INT16_MAX
+
+typedef struct nodeAggregate nodeAggregate_t;
+typedef struct aggregateQuery aggregateQuery_t;
+typedef struct rectangle2D rectangle2D_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+
+/* count, sums and grade1in histogram of the footpaths that have a data point under a quadtree node, each footpath 
+counted once even if both of its end points are under the node. min_shared_depth is the smallest shared_depth of 
+the end points under the node whose start point is not under the node (SHARED_LEAF if there is none) */
+struct nodeAggregate {
+  int footpaths;
+  int min_shared_depth;
+  int grade_bands[GRADE_BANDS];
+  double distance;
+  double deltaz;
+};
+
+/* an aggregate range query of aggregate_query: the query rectangle, an optional attribute filter and the aggregate 
+of the result */
+struct aggregateQuery {
+  rectangle2D_t *range;
+  attributeFilter_t *filter;
+  recordStore_t *records;
+  nodeAggregate_t result;
+};
+
+void empty_aggregate(nodeAggregate_t *aggregate);
+int grade_band(double gradelin);
+void add_record_to_aggregate(nodeAggregate_t *aggregate, recordStore_t *records, uint32_t id, int sign);
+void add_aggregate(nodeAggregate_t *aggregate, nodeAggregate_t *other);
+void print_aggregate(FILE *output, nodeAggregate_t *aggregate);
+
+#endif
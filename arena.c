@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "arena.h"
+
+treeArena_t tree_arena = {0, 0, 0, NULL, NULL, 0, 0};
+
+/*
+from now on, allocate the quadtrees from the tree arena. huge_pages: advise its blocks to use transparent huge
+pages (madvise), interleave: spread their pages across every NUMA node (mbind), so threads or processes on every
+node see the same average latency
+*/
+void enable_tree_arena(int huge_pages, int interleave) {
+  tree_arena.enabled = 1;
+  tree_arena.huge_pages = huge_pages;
+  tree_arena.interleave = interleave;
+}
+
+/*
+apply the placement of the tree arena (huge pages, NUMA interleaving) to a block of memory that is about to be
+filled. only the pages that lie entirely within the block are changed. a kernel without the support is reported
+once and the block is used as it is
+*/
+void place_memory(void *address, size_t bytes) {
+  static int reported = 0;
+  long page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t start = ((uintptr_t)address + page_size - 1) & ~(uintptr_t)(page_size - 1);
+  uintptr_t end = ((uintptr_t)address + bytes) & ~(uintptr_t)(page_size - 1);
+  if (!tree_arena.enabled || end <= start) {
+    return;
+  }
+  int failed = 0;
+  if (tree_arena.huge_pages && madvise((void *)start, end - start, MADV_HUGEPAGE) != 0) {
+    failed = 1;
+  }
+  /* every node is given, the kernel leaves out the nodes that do not exist or are not allowed */
+  unsigned long nodes = ~0UL;
+  if (tree_arena.interleave && syscall(SYS_mbind, (void *)start, end - start, MPOL_INTERLEAVE, &nodes,
+  8 * sizeof(nodes), MPOL_MF_MOVE) != 0) {
+    failed = 1;
+  }
+  if (failed && !reported) {
+    perror("memory placement");
+    reported = 1;
+  }
+}
+
+/*
+map a new block of the tree arena, aligned on a huge page
+*/
+void add_arena_chunk() {
+  size_t size = ARENA_CHUNK_SIZE + HUGE_PAGE_SIZE;
+  char *mapping = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(mapping != MAP_FAILED);
+  /* the parts before and after the aligned block are given back */
+  char *start = (char *)(((uintptr_t)mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+  if (start > mapping) {
+    munmap(mapping, start - mapping);
+  }
+  munmap(start + ARENA_CHUNK_SIZE, mapping + size - (start + ARENA_CHUNK_SIZE));
+  place_memory(start, ARENA_CHUNK_SIZE);
+
+  arenaChunk_t *chunk = (arenaChunk_t *)start;
+  chunk->next = tree_arena.chunks;
+  chunk->size = ARENA_CHUNK_SIZE;
+  tree_arena.chunks = chunk;
+  tree_arena.next = start + sizeof(arenaChunk_t);
+  tree_arena.left = ARENA_CHUNK_SIZE - sizeof(arenaChunk_t);
+}
+
+/*
+allocate size bytes for a quadtree: with malloc, or from the tree arena once it is enabled
+*/
+void *tree_alloc(size_t size) {
+  if (!tree_arena.enabled) {
+    void *address = malloc(size);
+    assert(address);
+    return address;
+  }
+  size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  assert(size <= ARENA_CHUNK_SIZE - sizeof(arenaChunk_t));
+  if (size > tree_arena.left) {
+    add_arena_chunk();
+  }
+  void *address = tree_arena.next;
+  tree_arena.next += size;
+  tree_arena.left -= size;
+  tree_arena.bytes += size;
+  return address;
+}
+
+/*
+free a block of tree_alloc. the tree arena is only released as a whole (release_tree_arena)
+*/
+void tree_free(void *address) {
+  if (!tree_arena.enabled) {
+    free(address);
+  }
+}
+
+/*
+unmap every block of the tree arena, the quadtrees allocated from it are gone
+*/
+void release_tree_arena() {
+  while (tree_arena.chunks != NULL) {
+    arenaChunk_t *chunk = tree_arena.chunks;
+    tree_arena.chunks = chunk->next;
+    munmap(chunk, chunk->size);
+  }
+  tree_arena.next = NULL;
+  tree_arena.left = 0;
+  tree_arena.bytes = 0;
+}
+
+/*
+pin the calling process to the CPU index (modulo the number of CPUs it may run on), so the memory it touches
+first is allocated on the NUMA node of that CPU. returns the CPU, or -1 if the process could not be pinned
+*/
+int pin_to_cpu(int index) {
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+    return -1;
+  }
+  int n = index % CPU_COUNT(&allowed);
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu ++) {
+    if (CPU_ISSET(cpu, &allowed) && n -- == 0) {
+      cpu_set_t pinned;
+      CPU_ZERO(&pinned);
+      CPU_SET(cpu, &pinned);
+      return (sched_setaffinity(0, sizeof(cpu_set_t), &pinned) == 0) ? cpu : -1;
+    }
+  }
+  return -1;
+}
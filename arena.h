@@ -0,0 +1,41 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/* size of the blocks of the tree arena, and of a transparent huge page (the blocks are aligned on it) */
+#define ARENA_CHUNK_SIZE (32 << 20)
+#define HUGE_PAGE_SIZE (2 << 20)
+/* alignment of every allocation of the tree arena */
+#define ARENA_ALIGNMENT 8
+
+typedef struct arenaChunk arenaChunk_t;
+typedef struct treeArena treeArena_t;
+
+/* a block of the tree arena; the blocks are chained through this header at their start */
+struct arenaChunk {
+  arenaChunk_t *next;
+  size_t size;
+};
+
+/* where the nodes, rectangles, points and lists of the quadtrees are allocated: with malloc while the arena is not
+enabled, otherwise from large blocks that are advised to use transparent huge pages (huge_pages) and/or interleaved
+across the NUMA nodes (interleave). the blocks are only released as a whole, by release_tree_arena */
+struct treeArena {
+  int enabled;
+  int huge_pages;
+  int interleave;
+  arenaChunk_t *chunks;
+  char *next;
+  size_t left;
+  long bytes;
+};
+
+void enable_tree_arena(int huge_pages, int interleave);
+void place_memory(void *address, size_t bytes);
+void *tree_alloc(size_t size);
+void tree_free(void *address);
+void release_tree_arena();
+int pin_to_cpu(int index);
+
+#endif
@@ -4,28 +4,7 @@
 #include <string.h>
 #include "data.h"
 #include "quadtree.h"
-
-struct data {
-  int footpath_id;
-  char *address;
-  char *clue_sa;
-  char *asset_type;
-  double deltaz;
-  double distance;
-  double gradelin;
-  int mcc_id;
-  int mccid_int;
-  double rlmax;
-  double rlmin;
-  char *segside;
-  int statusid;
-  int streetid;
-  int street_group;
-  double start_lat;
-  double start_lon;
-  double end_lat;
-  double end_lon;
-};
+#include "records.h"
 
 struct node {
   dataPoint_t *data_point;
@@ -33,89 +12,42 @@ struct node {
 };
 
 struct dataPoint {
-  data_t *data;
-  point2D_t *location;
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
 };
 
 /* 
-the function creates an empty node with mem allocated data_point and data pointers
+the function creates an empty node with a mem allocated data_point
 */
 node_t *create_empty_node() {
   node_t *node = (node_t *)malloc(sizeof(node_t));
+  assert(node);
   node->next = NULL;
   node->data_point = (dataPoint_t *)malloc(sizeof(dataPoint_t));
-  node->data_point->data = (data_t *)malloc(sizeof(data_t));
-  node->data_point->location = NULL;
-  assert(node && node->data_point && node->data_point->data);
+  assert(node->data_point);
+  node->data_point->end_point = FALSE;
+  node->data_point->shared_depth = -1;
   return node;
 }
 
-/* 
-copy all the attributes from a data source to a data desination, this function is used 
-to create an identical data point but with different location/point. Since for each node we stored in 
-the dictionary, we need to transfer it into two separate quadtreeNodes. One with start (lon/lat) point, another
-one with end (lon/lat) point.
-*/
-void copy_data(data_t *des, data_t *src) {
-  des->footpath_id = src->footpath_id;
-  des->address = strdup(src->address);
-  des->clue_sa = strdup(src->clue_sa);
-  des->asset_type = strdup(src->asset_type);
-  des->deltaz = src->deltaz;
-  des->distance = src->distance;
-  des->gradelin = src->gradelin;
-  des->mcc_id = src->mcc_id;
-  des->mccid_int = src->mccid_int;
-  des->rlmax = src->rlmax;
-  des->rlmin = src->rlmin;
-  des->segside = strdup(src->segside);
-  des->statusid = src->statusid;
-  des->streetid = src->streetid;
-  des->street_group = src->street_group;
-  des->start_lat = src->start_lat;
-  des->start_lon = src->start_lon;
-  des->end_lat = src->end_lat;
-  des->end_lon = src->end_lon;
-}
-
 /*
-create a node that uses end (lon/lat) as its location/point
+create a node that uses end (lon/lat) as its location/point. Since for each footpath we stored in the 
+dictionary, we need to transfer it into two separate quadtreeNodes, one with start (lon/lat) point, another
+one with end (lon/lat) point; both refer to the same record
 */
-node_t *create_end_point_node(node_t *node) {
-  node_t *ptr = (node_t *)malloc(sizeof(node_t));
-  assert(ptr);
-  ptr->next = NULL;
-  ptr->data_point = (dataPoint_t *)malloc(sizeof(dataPoint_t));
-  assert(ptr->data_point);
-  ptr->data_point->data = (data_t *)malloc(sizeof(data_t));
-  assert(ptr->data_point->data);
-  copy_data(ptr->data_point->data, node->data_point->data);
-  ptr->data_point->location = create_point(node->data_point->data->end_lon, node->data_point->data->end_lat);
+node_t *create_end_point_node(node_t *node, recordStore_t *records) {
+  node_t *ptr = create_empty_node();
+  uint32_t id = node->data_point->record_id;
+  ptr->data_point->record_id = id;
+  ptr->data_point->footpath_id = node->data_point->footpath_id;
+  ptr->data_point->location = point_at(records->end_lon[id], records->end_lat[id]);
+  ptr->data_point->end_point = TRUE;
   return ptr;
 }
 
-void fill_node(char **str_array, data_t *ptr) {
-  ptr->footpath_id = atoi(str_array[0]);
-  ptr->address = strdup(str_array[1]);
-  ptr->clue_sa = strdup(str_array[2]);
-  ptr->asset_type = strdup(str_array[3]);
-  sscanf(str_array[4], "%lf", &ptr->deltaz);
-  sscanf(str_array[5], "%lf", &ptr->distance);
-  sscanf(str_array[6], "%lf", &ptr->gradelin);
-  ptr->mcc_id = atoi(str_array[7]);
-  ptr->mccid_int = atoi(str_array[8]);
-  sscanf(str_array[9], "%lf", &ptr->rlmax);
-  sscanf(str_array[10], "%lf", &ptr->rlmin);
-  ptr->segside = strdup(str_array[11]);
-  ptr->statusid = atoi(str_array[12]);
-  ptr->streetid = atoi(str_array[13]);
-  ptr->street_group = atoi(str_array[14]);
-  sscanf(str_array[15], "%lf", &ptr->start_lat);
-  sscanf(str_array[16], "%lf", &ptr->start_lon);
-  sscanf(str_array[17], "%lf", &ptr->end_lat);
-  sscanf(str_array[18], "%lf", &ptr->end_lon);
-}
-
 void free_str_array(char **str_array, int n) {
   for (int i = 0; i < n; i ++) {
     free(str_array[i]);
@@ -124,7 +56,11 @@ void free_str_array(char **str_array, int n) {
   str_array = NULL;
 }
 
-void complete_node(char *line, dataPoint_t *ptr) {
+/* 
+the function tokenizes a csv line, appends it to the record store and points ptr at the new record, 
+with the start (lon/lat) of the footpath as its location
+*/
+void complete_node(char *line, dataPoint_t *ptr, recordStore_t *records) {
   /* create an empty (pointer to str) array */
   char **str_array = (char **)malloc(sizeof(char *) * NUM_OF_FIELDS);
   assert(str_array);
@@ -169,25 +105,13 @@ void complete_node(char *line, dataPoint_t *ptr) {
   }
   assert(index == NUM_OF_FIELDS);
     
-  fill_node(str_array, ptr->data);
-  ptr->location = create_point(ptr->data->start_lon, ptr->data->start_lat); 
+  ptr->record_id = add_record(records, str_array);
+  ptr->footpath_id = records->footpath_id[ptr->record_id];
+  ptr->location = point_at(records->start_lon[ptr->record_id], records->start_lat[ptr->record_id]);
 
   free_str_array(str_array, NUM_OF_FIELDS);
 }
 
-/* 
-the function prints the data_t attributes to the specified output stream
-*/
-void print_data_to_file(FILE *output, data_t *data) {
-  char *specifier = "--> footpath_id: %d || address: %s || clue_sa: %s || asset_type: %s || deltaz: %.2lf ||"
-  " distance: %.2lf || grade1in: %.1lf || mcc_id: %d || mccid_int: %d || rlmax: %.2lf || rlmin: %.2lf || segside: %s ||"
-  " statusid: %d || streetid: %d || street_group: %d || start_lat: %.6lf || start_lon: %.6lf || end_lat: %.6lf ||"
-  " end_lon: %.6lf ||\n";
-  fprintf(output, specifier, data->footpath_id, data->address, data->clue_sa, data->asset_type, data->deltaz, data->distance, data->gradelin,
-  data->mcc_id, data->mccid_int, data->rlmax, data->rlmin, data->segside, data->statusid, data->streetid, data->street_group, data->start_lat,
-  data->start_lon, data->end_lat, data->end_lon);
-}
-
 /* 
 the function frees the linked list that was used store nodes + datapoints 
 */
@@ -6,17 +6,14 @@
 #define MAX_FIELD_CHAR 128
 #define NUM_OF_FIELDS 19
 
-typedef struct data data_t;
 typedef struct node node_t;
 typedef struct dataPoint dataPoint_t;
+typedef struct recordStore recordStore_t;
 
 node_t *create_empty_node();
-void copy_data(data_t *des, data_t *src);
-node_t *create_end_point_node(node_t *node);
-void fill_node(char **str_array, data_t *ptr);
+node_t *create_end_point_node(node_t *node, recordStore_t *records);
 void free_str_array(char **str_array, int n);
-void complete_node(char *line, dataPoint_t *ptr);
-void print_data_to_file(FILE *output, data_t *data);
+void complete_node(char *line, dataPoint_t *ptr, recordStore_t *records);
 void free_list(node_t *head);
 
 #endif
\ No newline at end of file
@@ -1,36 +1,20 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <math.h>
 #include "data.h"
 #include "dict.h"
 #include "quadtree.h"
-
-struct data {
-  int footpath_id;
-  char *address;
-  char *clue_sa;
-  char *asset_type;
-  double deltaz;
-  double distance;
-  double gradelin;
-  int mcc_id;
-  int mccid_int;
-  double rlmax;
-  double rlmin;
-  char *segside;
-  int statusid;
-  int streetid;
-  int street_group;
-  double start_lat;
-  double start_lon;
-  double end_lat;
-  double end_lon;
-};
+#include "records.h"
 
 struct dataPoint {
-  data_t *data;
-  point2D_t *location;
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
 };
 
 struct node {
@@ -42,6 +26,11 @@ struct list {
   node_t *head;
   node_t *tail;
   int size;
+  /* the footpath records the data points of the list refer to */
+  recordStore_t *records;
+  /* the bounding box of the end points of the footpaths (bottom left x, bottom left y, upper right x, upper right y),
+  kept up to date by insert_to_dict */
+  double bounds[4];
 };
 
 /* 
@@ -52,6 +41,9 @@ dict_t *create_empty_dictionary() {
   assert(dict);
   dict->head = dict->tail = NULL;
   dict->size = 0;
+  dict->records = create_record_store();
+  dict->bounds[0] = dict->bounds[1] = HUGE_VAL;
+  dict->bounds[2] = dict->bounds[3] = -HUGE_VAL;
   return dict;
 }
 
@@ -63,7 +55,7 @@ void insert_to_dict(char *line, dict_t *dict) {
   node_t *ptr = create_empty_node();
 
   /* complete node with Start (lon/lat) Point */
-  complete_node(line, ptr->data_point);
+  complete_node(line, ptr->data_point, dict->records);
 
   /* insert into an empty dictionary */
   if (dict->size == 0) {
@@ -75,11 +67,22 @@ void insert_to_dict(char *line, dict_t *dict) {
     (dict->size) ++;
   }
 
-  node_t *end_point_node = create_end_point_node(ptr);
+  node_t *end_point_node = create_end_point_node(ptr, dict->records);
 
   dict->tail->next = end_point_node;
   dict->tail = end_point_node;
   (dict->size) ++;
+
+  uint32_t id = ptr->data_point->record_id;
+  recordStore_t *records = dict->records;
+  double x[] = {records->start_lon[id], records->end_lon[id]};
+  double y[] = {records->start_lat[id], records->end_lat[id]};
+  for (int i = 0; i < 2; i ++) {
+    dict->bounds[0] = (x[i] < dict->bounds[0]) ? x[i] : dict->bounds[0];
+    dict->bounds[1] = (y[i] < dict->bounds[1]) ? y[i] : dict->bounds[1];
+    dict->bounds[2] = (x[i] > dict->bounds[2]) ? x[i] : dict->bounds[2];
+    dict->bounds[3] = (y[i] > dict->bounds[3]) ? y[i] : dict->bounds[3];
+  }
 }
 
 /* 
@@ -97,6 +100,51 @@ void make_dictionary(FILE *input, dict_t *dict) {
   }
 }
 
+/* 
+read the lines appended to the input stream since it was last read (after make_dictionary: the lines written to the 
+file since then) and insert them into the dict. a line without a newline at its end is still being written, it is 
+left in the stream and read again by the next call. returns the first node added to the dict, or NULL if there is 
+none
+*/
+node_t *append_to_dictionary(FILE *input, dict_t *dict) {
+  node_t *last = dict->tail;
+  char *line = NULL;
+  size_t line_size = 0;
+  long offset = ftell(input);
+  ssize_t length = 0;
+  clearerr(input);
+  while ((length = getline(&line, &line_size, input)) > 0) {
+    if (line[length - 1] != '\n') {
+      fseek(input, offset, SEEK_SET);
+      break;
+    }
+    offset += length;
+    line[length - 1] = '\0';
+    /* empty lines are skipped, like the whitespace make_dictionary skips */
+    if (length > 1) {
+      insert_to_dict(line, dict);
+    }
+  }
+  /* the end of the file is only the end of what has been written so far */
+  clearerr(input);
+  free(line);
+  if (last == NULL) {
+    return dict->head;
+  }
+  return (last == dict->tail) ? NULL : last->next;
+}
+
+/* 
+make_dictionary for an input file that is still being written to (--follow): only the complete lines are read, the 
+line being written is left to append_to_dictionary
+*/
+void start_dictionary(FILE *input, dict_t *dict) {
+  /* getting rid of the header line */
+  int c = 0;
+  while ((c = fgetc(input)) != EOF && c != '\n');
+  append_to_dictionary(input, dict);
+}
+
 /*
 free the entire dict
 */
@@ -105,28 +153,34 @@ void free_dictionary(dict_t *dict) {
     return;
   }
 
-  /* empty dict */
-  if (dict->head == NULL) {
-    free(dict);
-    return;
-  }
-    
   while (dict->head != NULL) {
     node_t *ptr = dict->head;
     dict->head = dict->head->next;
     
-    free(ptr->data_point->data->address);
-    free(ptr->data_point->data->clue_sa);
-    free(ptr->data_point->data->segside);
-    free(ptr->data_point->data->asset_type);
-    free(ptr->data_point->data);
-    ptr->data_point->data = NULL;
-    
-    free(ptr->data_point->location);
     free(ptr->data_point);
     free(ptr);
     ptr = NULL;
   }
   dict->head = dict->tail = NULL;
+  free_record_store(dict->records);
   free(dict);
+}
+
+/*
+copy the bounding box of the footpaths of the dict into area (bottom left x, bottom left y, upper right x, upper 
+right y), returns FALSE (0) if the dict is empty
+*/
+int dictionary_bounds(dict_t *dict, double *area) {
+  if (dict->size == 0) {
+    return FALSE;
+  }
+  memcpy(area, dict->bounds, sizeof(dict->bounds));
+  return TRUE;
+}
+
+/*
+the record store of the dict
+*/
+recordStore_t *dictionary_records(dict_t *dict) {
+  return dict->records;
 }
\ No newline at end of file
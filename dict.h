@@ -1,15 +1,19 @@
 #ifndef _DICT_H_
 #define _DICT_H_
 
-typedef struct data data_t;
 typedef struct dataPoint dataPoint_t;
 typedef struct node node_t;
 typedef struct list list_t;
 typedef list_t dict_t;
+typedef struct recordStore recordStore_t;
 
 dict_t *create_empty_dictionary();
 void insert_to_dict(char *line, dict_t *dict);
 void make_dictionary(FILE *input, dict_t *dict);
+node_t *append_to_dictionary(FILE *input, dict_t *dict);
+void start_dictionary(FILE *input, dict_t *dict);
 void free_dictionary(dict_t *dict);
+int dictionary_bounds(dict_t *dict, double *area);
+recordStore_t *dictionary_records(dict_t *dict);
 
 #endif
\ No newline at end of file
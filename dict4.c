@@ -6,6 +6,9 @@
 #include "dict.h"
 #include "quadtree.h"
 #include "stage.h"
+#include "shard.h"
+#include "arena.h"
+#include "feed.h"
 
 int main(int argc, char **argv) {
   FILE *input = fopen(argv[INPUT_FILE_INDEX], "r");
@@ -13,30 +16,64 @@ int main(int argc, char **argv) {
   FILE *output = fopen(argv[OUTPUT_FILE_INDEX], "w");
   assert(output);
 
-  dict_t *dict = create_empty_dictionary();
-  make_dictionary(input, dict);
+  options_t options;
+  parse_options(argc, argv, &options);
+  set_quadtree_limits(options.max_depth, options.min_cell_size);
+  prepare_placement(&options);
+  // the root area: bottom left x, y and upper right x, y
+  double area[4];
+  read_root_area(argv, area);
+  if (options.index) {
+    /* the input file is a compressed index, no quadtree is built */
+    perform_stage_4_index(input, output, &options);
+    fclose(input);
+    fclose(output);
+    return 0;
+  }
+  if (options.shards > 0) {
+    /* the shard processes build the quadtrees, this process only splits the input and routes the queries */
+    perform_sharded_stage(SHARD_RANGE_QUERY, input, output, argv[OUTPUT_FILE_INDEX], area, &options);
+    fclose(input);
+    fclose(output);
+    return 0;
+  }
 
-  // x of bottomLeft for Node Area
-  long double start_lon = strtold(argv[START_LON_INDEX], NULL);
-  // y of bottomLeft for Node Area
-  long double start_lat = strtold(argv[START_LAT_INDEX], NULL);
-  // x of upperRight for Node Area
-  long double end_lon = strtold(argv[END_LON_INDEX], NULL);
-  // y of upperRight for Node Area
-  long double end_lat = strtold(argv[END_LAT_INDEX], NULL);
+  dict_t *dict = create_empty_dictionary();
+  prepare_root_area(input, &options, area);
+  if (options.follow) {
+    start_dictionary(input, dict);
+  } else {
+    make_dictionary(input, dict);
+  }
+  write_index_file(&options, dictionary_records(dict));
+  // --auto-bounds/--square-bounds: the bounding box of the footpaths instead
+  double bounds[4];
+  fit_root_area(&options, dictionary_bounds(dict, bounds) ? bounds : NULL, area);
 
-  point2D_t *bottom_left = create_point(start_lon, start_lat);
-  point2D_t *upper_right = create_point(end_lon, end_lat);
+  point2D_t *bottom_left = create_point(area[0], area[1]);
+  point2D_t *upper_right = create_point(area[2], area[3]);
   rectangle2D_t *node_area = create_rectangle(bottom_left, upper_right);
 
   quadtreeNode_t *root = create_empty_quadtree(node_area);
   make_quadtree(root, dict);
+  if (options.tree_stats) {
+    report_quadtree_stats(stderr, root, dictionary_records(dict));
+  }
+
+  if (options.follow) {
+    /* the rows appended to the input file from now on are added before each query */
+    options.feed = follow_input(input, dict, root);
+  }
 
   // stage 4
-  perform_stage_4(output, root);
+  perform_stage_4(output, root, dictionary_records(dict), &options);
+  if (options.feed != NULL) {
+    close_feed(options.feed);
+  }
    
   free_quadtree(root);
   free_dictionary(dict);
+  release_tree_arena();
   bottom_left = upper_right = NULL;
   node_area = NULL;
   fclose(input);
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "dict.h"
+#include "quadtree.h"
+#include "feed.h"
+
+/* 
+follow the input file the dict was read from (make_dictionary) and the quadtree was built from
+*/
+footpathFeed_t *follow_input(FILE *input, dict_t *dict, quadtreeNode_t *root) {
+  footpathFeed_t *feed = (footpathFeed_t *)malloc(sizeof(footpathFeed_t));
+  assert(feed);
+  feed->input = input;
+  feed->dict = dict;
+  feed->root = root;
+  feed->rows = 0;
+  feed->batches = 0;
+  return feed;
+}
+
+/* 
+add every complete row appended to the input file since the last poll to the dict and, as one batch, to the 
+quadtree. returns the number of rows added
+*/
+int poll_feed(footpathFeed_t *feed) {
+  node_t *first = append_to_dictionary(feed->input, feed->dict);
+  if (first == NULL) {
+    return 0;
+  }
+  /* every row is a start and an end data point */
+  int rows = insert_batch_to_quadtree(feed->root, first, dictionary_records(feed->dict)) / 2;
+  feed->rows += rows;
+  feed->batches ++;
+  return rows;
+}
+
+void close_feed(footpathFeed_t *feed) {
+  free(feed);
+}
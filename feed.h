@@ -0,0 +1,26 @@
+#ifndef _FEED_H_
+#define _FEED_H_
+
+#include <stdio.h>
+
+typedef struct footpathFeed footpathFeed_t;
+typedef struct list list_t;
+typedef list_t dict_t;
+typedef struct quadtreeNode quadtreeNode_t;
+
+/* an input file that is still being appended to (--follow): the rows written to it after the quadtree was built 
+are added to the dictionary and the quadtree in batches, one batch per poll_feed */
+struct footpathFeed {
+  FILE *input;
+  dict_t *dict;
+  quadtreeNode_t *root;
+  /* number of rows and of non-empty batches added so far */
+  long rows;
+  long batches;
+};
+
+footpathFeed_t *follow_input(FILE *input, dict_t *dict, quadtreeNode_t *root);
+int poll_feed(footpathFeed_t *feed);
+void close_feed(footpathFeed_t *feed);
+
+#endif
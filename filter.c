@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include "quadtree.h"
+#include "records.h"
+#include "filter.h"
+
+/* 
+reset a summary to the summary of no data point; merging any summary into it gives that summary
+*/
+void empty_summary(nodeSummary_t *summary) {
+  summary->min_footpath_id = INT_MAX;
+  summary->max_footpath_id = INT_MIN;
+  summary->id_ranges = 0;
+  summary->asset_types = 0;
+  summary->statuses = 0;
+  summary->min_street_group = INT_MAX;
+  summary->max_street_group = INT_MIN;
+  summary->min_gradelin = summary->min_distance = HUGE_VAL;
+  summary->max_gradelin = summary->max_distance = -HUGE_VAL;
+}
+
+/* 
+set summary to the summary of the single record with the given id
+*/
+void summarise_record(nodeSummary_t *summary, recordStore_t *records, uint32_t id) {
+  summary->min_footpath_id = summary->max_footpath_id = records->footpath_id[id];
+  summary->id_ranges = 1ULL << id_range(records, records->footpath_id[id]);
+  summary->asset_types = 1ULL << (records->asset_type[id] & 63);
+  summary->statuses = 1ULL << ((uint32_t)records->statusid[id] & 63);
+  summary->min_street_group = summary->max_street_group = records->street_group[id];
+  summary->min_gradelin = summary->max_gradelin = records->gradelin[id];
+  summary->min_distance = summary->max_distance = records->distance[id];
+}
+
+/* 
+widen summary so it also covers the data points of other
+*/
+void merge_summary(nodeSummary_t *summary, nodeSummary_t *other) {
+  if (other->min_footpath_id < summary->min_footpath_id) {
+    summary->min_footpath_id = other->min_footpath_id;
+  }
+  if (other->max_footpath_id > summary->max_footpath_id) {
+    summary->max_footpath_id = other->max_footpath_id;
+  }
+  summary->id_ranges |= other->id_ranges;
+  summary->asset_types |= other->asset_types;
+  summary->statuses |= other->statuses;
+  if (other->min_street_group < summary->min_street_group) {
+    summary->min_street_group = other->min_street_group;
+  }
+  if (other->max_street_group > summary->max_street_group) {
+    summary->max_street_group = other->max_street_group;
+  }
+  if (other->min_gradelin < summary->min_gradelin) {
+    summary->min_gradelin = other->min_gradelin;
+  }
+  if (other->max_gradelin > summary->max_gradelin) {
+    summary->max_gradelin = other->max_gradelin;
+  }
+  if (other->min_distance < summary->min_distance) {
+    summary->min_distance = other->min_distance;
+  }
+  if (other->max_distance > summary->max_distance) {
+    summary->max_distance = other->max_distance;
+  }
+}
+
+/* 
+reset a filter to the predicate every record matches
+*/
+void init_filter(attributeFilter_t *filter) {
+  filter->records = NULL;
+  filter->has_asset_type = FALSE;
+  filter->asset_type = -1;
+  filter->has_statusid = FALSE;
+  filter->statusid = 0;
+  filter->has_street_group = FALSE;
+  filter->street_group = 0;
+  filter->min_gradelin = filter->min_distance = -HUGE_VAL;
+  filter->max_gradelin = filter->max_distance = HUGE_VAL;
+}
+
+/* 
+returns FALSE (0) if no data point described by the summary can match the filter, so the subtree can be 
+skipped. otherwise TRUE (1), the data points still have to be tested with filter_matches_record
+*/
+int filter_may_match(attributeFilter_t *filter, nodeSummary_t *summary) {
+  if (filter->has_asset_type && (filter->asset_type < 0 || 
+  !(summary->asset_types & (1ULL << ((uint32_t)filter->asset_type & 63))))) {
+    return FALSE;
+  }
+  if (filter->has_statusid && !(summary->statuses & (1ULL << ((uint32_t)filter->statusid & 63)))) {
+    return FALSE;
+  }
+  if (filter->has_street_group && (filter->street_group < summary->min_street_group || 
+  filter->street_group > summary->max_street_group)) {
+    return FALSE;
+  }
+  if (summary->max_gradelin < filter->min_gradelin || summary->min_gradelin > filter->max_gradelin) {
+    return FALSE;
+  }
+  if (summary->max_distance < filter->min_distance || summary->min_distance > filter->max_distance) {
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* 
+returns TRUE (1) if the record with the given id satisfies every constraint of the filter, otherwise FALSE (0)
+*/
+int filter_matches_record(attributeFilter_t *filter, uint32_t id) {
+  recordStore_t *records = filter->records;
+  if (filter->has_asset_type && (filter->asset_type < 0 || records->asset_type[id] != (uint32_t)filter->asset_type)) {
+    return FALSE;
+  }
+  if (filter->has_statusid && records->statusid[id] != filter->statusid) {
+    return FALSE;
+  }
+  if (filter->has_street_group && records->street_group[id] != filter->street_group) {
+    return FALSE;
+  }
+  if (records->gradelin[id] < filter->min_gradelin || records->gradelin[id] > filter->max_gradelin) {
+    return FALSE;
+  }
+  if (records->distance[id] < filter->min_distance || records->distance[id] > filter->max_distance) {
+    return FALSE;
+  }
+  return TRUE;
+}
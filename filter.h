@@ -0,0 +1,52 @@
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <stdint.h>
+
+typedef struct nodeSummary nodeSummary_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+
+/* aggregate of the attributes of every data point stored under a quadtree node. asset_types/statuses are bitmasks 
+with bit (asset_type id % 64) / (statusid % 64) set for each value present; values sharing a bit only make the 
+summary less selective, never wrong. id_ranges has bit k set if a footpath_id of id range k (see set_id_ranges) 
+is present */
+struct nodeSummary {
+  int min_footpath_id;
+  int max_footpath_id;
+  uint64_t id_ranges;
+  uint64_t asset_types;
+  uint64_t statuses;
+  int min_street_group;
+  int max_street_group;
+  double min_gradelin;
+  double max_gradelin;
+  double min_distance;
+  double max_distance;
+};
+
+/* attribute predicate of a filtered range query, a record matches when it satisfies every given constraint.
+the ranges are inclusive and unbounded by default */
+struct attributeFilter {
+  recordStore_t *records;
+  int has_asset_type;
+  /* string id of the wanted asset_type, -1 when the string is not in the pool (nothing can match) */
+  int asset_type;
+  int has_statusid;
+  int statusid;
+  int has_street_group;
+  int street_group;
+  double min_gradelin;
+  double max_gradelin;
+  double min_distance;
+  double max_distance;
+};
+
+void empty_summary(nodeSummary_t *summary);
+void summarise_record(nodeSummary_t *summary, recordStore_t *records, uint32_t id);
+void merge_summary(nodeSummary_t *summary, nodeSummary_t *other);
+void init_filter(attributeFilter_t *filter);
+int filter_may_match(attributeFilter_t *filter, nodeSummary_t *summary);
+int filter_matches_record(attributeFilter_t *filter, uint32_t id);
+
+#endif
@@ -0,0 +1,615 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "index.h"
+#include "records.h"
+#include "filter.h"
+#include "quadtree.h"
+
+typedef struct indexWriter indexWriter_t;
+
+/* 
+the state of write_index: the records in Morton order of their midpoints (order, with the codes), their 
+quantised co-ordinates (start x, start y, end x, end y for every record id), the directory built so far and the 
+encoded blocks
+*/
+struct indexWriter {
+  recordStore_t *records;
+  indexHeader_t header;
+  uint32_t *order;
+  uint64_t *codes;
+  uint32_t *quantised;
+  indexNode_t *nodes;
+  int nodes_size;
+  int nodes_capacity;
+  byteBuffer_t blocks;
+  byteBuffer_t block_sizes;
+};
+
+/* 
+make room for n more bytes at the end of the buffer
+*/
+void reserve_bytes(byteBuffer_t *buffer, size_t n) {
+  if (buffer->size + n <= buffer->capacity) {
+    return;
+  }
+  while (buffer->size + n > buffer->capacity) {
+    buffer->capacity = (buffer->capacity == 0) ? 4096 : 2 * buffer->capacity;
+  }
+  buffer->bytes = (unsigned char *)realloc(buffer->bytes, buffer->capacity);
+  assert(buffer->bytes);
+}
+
+/* 
+append an unsigned value as a varint: 7 bits per byte, the low bits first, the high bit set on every byte but the last
+*/
+void put_varint(byteBuffer_t *buffer, uint64_t value) {
+  reserve_bytes(buffer, MAX_VARINT_BYTES);
+  while (value >= 0x80) {
+    buffer->bytes[buffer->size ++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  buffer->bytes[buffer->size ++] = (unsigned char)value;
+}
+
+/* 
+read the varint at the position of the buffer
+*/
+uint64_t get_varint(byteBuffer_t *buffer) {
+  uint64_t value = 0;
+  int shift = 0;
+  unsigned char byte;
+  do {
+    assert(buffer->position < buffer->size && shift < 7 * MAX_VARINT_BYTES);
+    byte = buffer->bytes[buffer->position ++];
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+/* 
+map a signed value to an unsigned one with small magnitudes first (0, -1, 1, -2, ...), so it makes a short varint
+*/
+uint64_t zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* 
+the bits of a double as an integer, and back
+*/
+uint64_t double_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double bits_double(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* 
+append a double exactly: as an approximation (here) and the difference of its bits to the bits of the approximation 
+(a residual, 0 when the approximation is the value itself)
+*/
+void put_residual(byteBuffer_t *buffer, double value, double approximation) {
+  put_varint(buffer, zigzag((int64_t)(double_bits(value) - double_bits(approximation))));
+}
+
+double get_residual(byteBuffer_t *buffer, double approximation) {
+  return bits_double(double_bits(approximation) + (uint64_t)unzigzag(get_varint(buffer)));
+}
+
+/* 
+append a double of a decimal column (deltaz, distance, ...) as its number of hundredths and a residual. a value read 
+from the csv file with at most two decimals is that number divided by 100, so the residual is 0
+*/
+void put_decimal(byteBuffer_t *buffer, double value) {
+  int64_t scaled = 0;
+  if (isfinite(value) && fabs(value * INDEX_DECIMAL_SCALE) < 1e15) {
+    scaled = llround(value * INDEX_DECIMAL_SCALE);
+  }
+  put_varint(buffer, zigzag(scaled));
+  put_residual(buffer, value, scaled / INDEX_DECIMAL_SCALE);
+}
+
+double get_decimal(byteBuffer_t *buffer) {
+  int64_t scaled = unzigzag(get_varint(buffer));
+  return get_residual(buffer, scaled / INDEX_DECIMAL_SCALE);
+}
+
+/* 
+the quantised co-ordinate of a value on the given axis (0: x, 1: y) of the index, and its approximation
+*/
+uint32_t quantise(indexHeader_t *header, double value, int axis) {
+  double q = round((value - header->origin[axis]) / header->unit);
+  assert(q >= 0 && q <= UINT32_MAX);
+  return (uint32_t)q;
+}
+
+double dequantise(indexHeader_t *header, uint32_t q, int axis) {
+  return header->origin[axis] + q * header->unit;
+}
+
+/* 
+orders two (Morton code, record id) pairs
+*/
+int compare_morton(const void *a, const void *b) {
+  const uint64_t *p1 = (const uint64_t *)a;
+  const uint64_t *p2 = (const uint64_t *)b;
+  if (p1[0] != p2[0]) {
+    return (p1[0] < p2[0]) ? -1 : 1;
+  }
+  return (p1[1] < p2[1]) ? -1 : (p1[1] > p2[1]);
+}
+
+/* 
+encode the records order[lo] to order[hi - 1] as the next block. each block starts from zero, so it can be decoded 
+on its own. the co-ordinates come first, so a query can test them before it decodes the rest: the quantised start 
+point of every record as the difference to the previous start point (small, the records are in Morton order of 
+their midpoints) and 
+its end point as the difference to the start point, then the residuals to the exact doubles. then for every 
+record, the footpath_id as the difference to the previous one, the strings as ids of the string dictionary, the 
+decimals as hundredths (put_decimal) and the other integers as zigzag varints
+*/
+void encode_block(indexWriter_t *writer, int lo, int hi) {
+  recordStore_t *records = writer->records;
+  indexHeader_t *header = &writer->header;
+  byteBuffer_t *buffer = &writer->blocks;
+  size_t start = buffer->size;
+  put_varint(buffer, hi - lo);
+  int64_t previous_x = 0, previous_y = 0, previous_id = 0;
+  for (int i = lo; i < hi; i ++) {
+    uint32_t *q = &writer->quantised[4 * writer->order[i]];
+    put_varint(buffer, zigzag((int64_t)q[0] - previous_x));
+    put_varint(buffer, zigzag((int64_t)q[1] - previous_y));
+    put_varint(buffer, zigzag((int64_t)q[2] - q[0]));
+    put_varint(buffer, zigzag((int64_t)q[3] - q[1]));
+    previous_x = q[0];
+    previous_y = q[1];
+  }
+  for (int i = lo; i < hi; i ++) {
+    uint32_t id = writer->order[i];
+    uint32_t *q = &writer->quantised[4 * id];
+    put_residual(buffer, records->start_lon[id], dequantise(header, q[0], 0));
+    put_residual(buffer, records->start_lat[id], dequantise(header, q[1], 1));
+    put_residual(buffer, records->end_lon[id], dequantise(header, q[2], 0));
+    put_residual(buffer, records->end_lat[id], dequantise(header, q[3], 1));
+  }
+  for (int i = lo; i < hi; i ++) {
+    uint32_t id = writer->order[i];
+    put_varint(buffer, zigzag(records->footpath_id[id] - previous_id));
+    previous_id = records->footpath_id[id];
+    put_varint(buffer, records->address[id]);
+    put_varint(buffer, records->clue_sa[id]);
+    put_varint(buffer, records->asset_type[id]);
+    put_varint(buffer, records->segside[id]);
+    put_decimal(buffer, records->deltaz[id]);
+    put_decimal(buffer, records->distance[id]);
+    put_decimal(buffer, records->gradelin[id]);
+    put_decimal(buffer, records->rlmax[id]);
+    put_decimal(buffer, records->rlmin[id]);
+    put_varint(buffer, zigzag(records->mcc_id[id]));
+    put_varint(buffer, zigzag(records->mccid_int[id]));
+    put_varint(buffer, zigzag(records->statusid[id]));
+    put_varint(buffer, zigzag(records->streetid[id]));
+    put_varint(buffer, zigzag(records->street_group[id]));
+  }
+  put_varint(&writer->block_sizes, buffer->size - start);
+  writer->header.blocks ++;
+}
+
+/* 
+add the directory cell of the records order[lo] to order[hi - 1], whose Morton codes share their first 2 * level 
+bits, and return its node. a cell with at most INDEX_BLOCK_RECORDS records (or a single code) becomes a block, the 
+others are split into four by the next two bits. the nodes are added in preorder
+*/
+int build_index_node(indexWriter_t *writer, int lo, int hi, int level) {
+  if (writer->nodes_size == writer->nodes_capacity) {
+    writer->nodes_capacity = (writer->nodes_capacity == 0) ? 64 : 2 * writer->nodes_capacity;
+    writer->nodes = (indexNode_t *)realloc(writer->nodes, sizeof(indexNode_t) * writer->nodes_capacity);
+    assert(writer->nodes);
+  }
+  int n = writer->nodes_size ++;
+  indexNode_t node = {{UINT32_MAX, UINT32_MAX, 0, 0}, -1, {-1, -1, -1, -1}};
+
+  if (hi - lo <= INDEX_BLOCK_RECORDS || level == INDEX_MAX_LEVEL) {
+    node.block = writer->header.blocks;
+    encode_block(writer, lo, hi);
+    for (int i = lo; i < hi; i ++) {
+      uint32_t *q = &writer->quantised[4 * writer->order[i]];
+      for (int axis = 0; axis < 2; axis ++) {
+        uint32_t low = (q[axis] < q[axis + 2]) ? q[axis] : q[axis + 2];
+        uint32_t high = (q[axis] > q[axis + 2]) ? q[axis] : q[axis + 2];
+        node.box[axis] = (low < node.box[axis]) ? low : node.box[axis];
+        node.box[axis + 2] = (high > node.box[axis + 2]) ? high : node.box[axis + 2];
+      }
+    }
+  } else {
+    int shift = 62 - 2 * level;
+    int start = lo;
+    while (start < hi) {
+      int quadrant = (writer->codes[start] >> shift) & 3;
+      int end = start;
+      while (end < hi && (int)((writer->codes[end] >> shift) & 3) == quadrant) {
+        end ++;
+      }
+      int child = build_index_node(writer, start, end, level + 1);
+      node.children[quadrant] = child;
+      indexNode_t *c = &writer->nodes[child];
+      for (int axis = 0; axis < 2; axis ++) {
+        node.box[axis] = (c->box[axis] < node.box[axis]) ? c->box[axis] : node.box[axis];
+        node.box[axis + 2] = (c->box[axis + 2] > node.box[axis + 2]) ? c->box[axis + 2] : node.box[axis + 2];
+      }
+      start = end;
+    }
+  }
+  writer->nodes[n] = node;
+  return n;
+}
+
+/* 
+write the compressed index of the records: the header, then the string dictionary, the directory (in preorder: the 
+box of a node, a mask of its children, and its block if it has none) and the size of every block as varints, then 
+the blocks
+*/
+void write_index(FILE *output, recordStore_t *records) {
+  indexWriter_t writer;
+  memset(&writer, 0, sizeof(indexWriter_t));
+  writer.records = records;
+  indexHeader_t *header = &writer.header;
+  header->magic = INDEX_MAGIC;
+  header->version = INDEX_VERSION;
+  header->records = records->size;
+  header->strings = records->strings->size;
+  header->unit = INDEX_UNIT;
+
+  /* the origin is the bottom left corner of every end point */
+  header->origin[0] = header->origin[1] = 0;
+  for (int i = 0; i < records->size; i ++) {
+    double x = (records->start_lon[i] < records->end_lon[i]) ? records->start_lon[i] : records->end_lon[i];
+    double y = (records->start_lat[i] < records->end_lat[i]) ? records->start_lat[i] : records->end_lat[i];
+    header->origin[0] = (i == 0 || x < header->origin[0]) ? x : header->origin[0];
+    header->origin[1] = (i == 0 || y < header->origin[1]) ? y : header->origin[1];
+  }
+
+  /* the records in Morton order of their quantised midpoints: the box of a cell then reaches half a footpath beyond 
+  it on every side, instead of a whole one with the start points */
+  int n = records->size;
+  uint64_t *pairs = (uint64_t *)malloc(sizeof(uint64_t) * 2 * (n + 1));
+  writer.order = (uint32_t *)malloc(sizeof(uint32_t) * (n + 1));
+  writer.codes = (uint64_t *)malloc(sizeof(uint64_t) * (n + 1));
+  writer.quantised = (uint32_t *)malloc(sizeof(uint32_t) * 4 * (n + 1));
+  assert(pairs && writer.order && writer.codes && writer.quantised);
+  for (int i = 0; i < n; i ++) {
+    uint32_t *q = &writer.quantised[4 * i];
+    q[0] = quantise(header, records->start_lon[i], 0);
+    q[1] = quantise(header, records->start_lat[i], 1);
+    q[2] = quantise(header, records->end_lon[i], 0);
+    q[3] = quantise(header, records->end_lat[i], 1);
+    uint32_t middle_x = (uint32_t)(((uint64_t)q[0] + q[2]) / 2);
+    uint32_t middle_y = (uint32_t)(((uint64_t)q[1] + q[3]) / 2);
+    pairs[2 * i] = spread_bits(middle_x) | (spread_bits(middle_y) << 1);
+    pairs[2 * i + 1] = i;
+  }
+  qsort(pairs, n, 2 * sizeof(uint64_t), compare_morton);
+  for (int i = 0; i < n; i ++) {
+    writer.codes[i] = pairs[2 * i];
+    writer.order[i] = (uint32_t)pairs[2 * i + 1];
+  }
+  free(pairs);
+  build_index_node(&writer, 0, n, 0);
+  header->nodes = writer.nodes_size;
+
+  byteBuffer_t meta = {NULL, 0, 0, 0};
+  for (int i = 0; i < records->strings->size; i ++) {
+    char *str = get_string(records->strings, i);
+    size_t length = strlen(str);
+    put_varint(&meta, length);
+    reserve_bytes(&meta, length);
+    memcpy(meta.bytes + meta.size, str, length);
+    meta.size += length;
+  }
+  for (int i = 0; i < writer.nodes_size; i ++) {
+    indexNode_t *node = &writer.nodes[i];
+    for (int k = 0; k < 4; k ++) {
+      put_varint(&meta, node->box[k]);
+    }
+    int mask = 0;
+    for (int quadrant = 0; quadrant < 4; quadrant ++) {
+      mask |= (node->children[quadrant] != -1) << quadrant;
+    }
+    put_varint(&meta, mask);
+    if (mask == 0) {
+      put_varint(&meta, node->block);
+    }
+  }
+  reserve_bytes(&meta, writer.block_sizes.size);
+  memcpy(meta.bytes + meta.size, writer.block_sizes.bytes, writer.block_sizes.size);
+  meta.size += writer.block_sizes.size;
+  header->meta_size = meta.size;
+
+  fwrite(header, sizeof(indexHeader_t), 1, output);
+  fwrite(meta.bytes, 1, meta.size, output);
+  fwrite(writer.blocks.bytes, 1, writer.blocks.size, output);
+
+  free(meta.bytes);
+  free(writer.blocks.bytes);
+  free(writer.block_sizes.bytes);
+  free(writer.nodes);
+  free(writer.order);
+  free(writer.codes);
+  free(writer.quantised);
+}
+
+/* 
+read the directory node at the position of the buffer (and its children, in preorder) into index->nodes[*n] on
+*/
+int read_index_node(footpathIndex_t *index, byteBuffer_t *meta, int *n) {
+  assert(*n < (int)index->header.nodes);
+  int id = (*n) ++;
+  indexNode_t *node = &index->nodes[id];
+  for (int k = 0; k < 4; k ++) {
+    node->box[k] = (uint32_t)get_varint(meta);
+  }
+  int mask = (int)get_varint(meta);
+  node->block = (mask == 0) ? (int)get_varint(meta) : -1;
+  for (int quadrant = 0; quadrant < 4; quadrant ++) {
+    index->nodes[id].children[quadrant] = (mask & (1 << quadrant)) ? read_index_node(index, meta, n) : -1;
+  }
+  return id;
+}
+
+/* 
+open a compressed index written by write_index: its string dictionary, directory and block offsets are read, the 
+blocks stay in the file until a query needs them
+*/
+footpathIndex_t *open_index(FILE *input) {
+  footpathIndex_t *index = (footpathIndex_t *)malloc(sizeof(footpathIndex_t));
+  assert(index);
+  index->file = input;
+  size_t n_read = fread(&index->header, sizeof(indexHeader_t), 1, input);
+  assert(n_read == 1);
+  assert(index->header.magic == INDEX_MAGIC && index->header.version == INDEX_VERSION);
+
+  byteBuffer_t meta = {NULL, 0, 0, 0};
+  reserve_bytes(&meta, index->header.meta_size);
+  n_read = fread(meta.bytes, 1, index->header.meta_size, input);
+  assert(n_read == index->header.meta_size);
+  meta.size = index->header.meta_size;
+
+  /* the strings get the same ids as in the record store they were written from */
+  index->records = create_record_store();
+  char *str = NULL;
+  for (uint32_t i = 0; i < index->header.strings; i ++) {
+    size_t length = get_varint(&meta);
+    assert(meta.position + length <= meta.size);
+    str = (char *)realloc(str, length + 1);
+    assert(str);
+    memcpy(str, meta.bytes + meta.position, length);
+    str[length] = '\0';
+    meta.position += length;
+    uint32_t id = intern_string(index->records->strings, str);
+    assert(id == i);
+  }
+  free(str);
+
+  index->nodes = (indexNode_t *)malloc(sizeof(indexNode_t) * index->header.nodes);
+  assert(index->nodes);
+  int n = 0;
+  read_index_node(index, &meta, &n);
+
+  index->block_offsets = (uint64_t *)malloc(sizeof(uint64_t) * (index->header.blocks + 1));
+  assert(index->block_offsets);
+  index->block_offsets[0] = sizeof(indexHeader_t) + index->header.meta_size;
+  for (uint32_t i = 0; i < index->header.blocks; i ++) {
+    index->block_offsets[i + 1] = index->block_offsets[i] + get_varint(&meta);
+  }
+  free(meta.bytes);
+
+  /* the blocks are read through a shared read-only mapping of the file, so they are only paged in (and kept in the 
+  page cache) when a query touches them */
+  struct stat status;
+  int failed = fstat(fileno(input), &status);
+  assert(!failed && (uint64_t)status.st_size >= index->block_offsets[index->header.blocks]);
+  index->mapping_size = status.st_size;
+  index->mapping = (unsigned char *)mmap(NULL, index->mapping_size, PROT_READ, MAP_SHARED, fileno(input), 0);
+  assert(index->mapping != MAP_FAILED);
+  index->block = (byteBuffer_t){NULL, 0, 0, 0};
+  return index;
+}
+
+void close_index(footpathIndex_t *index) {
+  free_record_store(index->records);
+  free(index->nodes);
+  free(index->block_offsets);
+  munmap(index->mapping, index->mapping_size);
+  free(index);
+}
+
+/* 
+returns TRUE (1) if the point (x, y) lies within the range (bottom left x, y and upper right x, y)
+*/
+int in_range(double *range, double x, double y) {
+  return x >= range[0] && x <= range[2] && y >= range[1] && y <= range[3];
+}
+
+/* 
+decode a block of the index and append its records to index->records (see encode_block), and return the number of 
+them with an end point within the range. a block without one is taken out again before the rest of its records 
+(everything but the co-ordinates) is decoded
+*/
+int decode_block(footpathIndex_t *index, int block, double *range) {
+  indexHeader_t *header = &index->header;
+  byteBuffer_t *buffer = &index->block;
+  /* the block is decoded where it is mapped */
+  buffer->bytes = index->mapping + index->block_offsets[block];
+  buffer->size = index->block_offsets[block + 1] - index->block_offsets[block];
+  buffer->position = 0;
+
+  recordStore_t *records = index->records;
+  int count = (int)get_varint(buffer);
+  while (records->size + count > records->capacity) {
+    grow_record_store(records);
+  }
+  int first = records->size;
+  /* the quantised co-ordinates are within half a unit of the doubles, a block without a point within the range 
+  widened by a unit is left before its residuals are read */
+  double unit = header->unit;
+  double widened[4] = {range[0] - unit, range[1] - unit, range[2] + unit, range[3] + unit};
+  int within = 0;
+  int64_t x = 0, y = 0;
+  for (int id = first; id < first + count; id ++) {
+    x += unzigzag(get_varint(buffer));
+    y += unzigzag(get_varint(buffer));
+    int64_t end_x = x + unzigzag(get_varint(buffer));
+    int64_t end_y = y + unzigzag(get_varint(buffer));
+    records->start_lon[id] = dequantise(header, (uint32_t)x, 0);
+    records->start_lat[id] = dequantise(header, (uint32_t)y, 1);
+    records->end_lon[id] = dequantise(header, (uint32_t)end_x, 0);
+    records->end_lat[id] = dequantise(header, (uint32_t)end_y, 1);
+    within += in_range(widened, records->start_lon[id], records->start_lat[id]) || 
+    in_range(widened, records->end_lon[id], records->end_lat[id]);
+  }
+  if (within == 0) {
+    return 0;
+  }
+  within = 0;
+  for (int id = first; id < first + count; id ++) {
+    records->start_lon[id] = get_residual(buffer, records->start_lon[id]);
+    records->start_lat[id] = get_residual(buffer, records->start_lat[id]);
+    records->end_lon[id] = get_residual(buffer, records->end_lon[id]);
+    records->end_lat[id] = get_residual(buffer, records->end_lat[id]);
+    within += in_range(range, records->start_lon[id], records->start_lat[id]) || 
+    in_range(range, records->end_lon[id], records->end_lat[id]);
+  }
+  if (within == 0) {
+    return 0;
+  }
+
+  records->size += count;
+  int64_t footpath_id = 0;
+  for (int id = first; id < first + count; id ++) {
+    footpath_id += unzigzag(get_varint(buffer));
+    records->footpath_id[id] = (int)footpath_id;
+    records->address[id] = (uint32_t)get_varint(buffer);
+    records->clue_sa[id] = (uint32_t)get_varint(buffer);
+    records->asset_type[id] = (uint32_t)get_varint(buffer);
+    records->segside[id] = (uint32_t)get_varint(buffer);
+    records->deltaz[id] = get_decimal(buffer);
+    records->distance[id] = get_decimal(buffer);
+    records->gradelin[id] = get_decimal(buffer);
+    records->rlmax[id] = get_decimal(buffer);
+    records->rlmin[id] = get_decimal(buffer);
+    records->mcc_id[id] = (int)unzigzag(get_varint(buffer));
+    records->mccid_int[id] = (int)unzigzag(get_varint(buffer));
+    records->statusid[id] = (int)unzigzag(get_varint(buffer));
+    records->streetid[id] = (int)unzigzag(get_varint(buffer));
+    records->street_group[id] = (int)unzigzag(get_varint(buffer));
+  }
+  return within;
+}
+
+/* 
+orders two index matches by footpath_id, then by record id
+*/
+int compare_index_match(const void *a, const void *b) {
+  const indexMatch_t *m1 = (const indexMatch_t *)a;
+  const indexMatch_t *m2 = (const indexMatch_t *)b;
+  if (m1->footpath_id != m2->footpath_id) {
+    return (m1->footpath_id < m2->footpath_id) ? -1 : 1;
+  }
+  return (m1->id < m2->id) ? -1 : (m1->id > m2->id);
+}
+
+/* 
+the function answers a range query (bottom left x, y and upper right x, y) from the index: only the blocks whose 
+box overlaps the range are read and decoded (their numbers are printed to stdout if show_blocks is TRUE), into 
+index->records. the ids (in index->records) of the footpaths with an end point within the range that match the 
+filter (NULL for none) are written to a new array *results (to be freed by the caller) in footpath_id order, the same 
+footpaths as range_query, and their number is returned
+*/
+int index_range_query(footpathIndex_t *index, double *range, attributeFilter_t *filter, int show_blocks, 
+uint32_t **results) {
+  indexHeader_t *header = &index->header;
+  recordStore_t *records = index->records;
+  records->size = 0;
+  /* the quantised co-ordinates are within half a unit of the values, the range is widened by one unit */
+  double low[2], high[2];
+  for (int axis = 0; axis < 2; axis ++) {
+    low[axis] = floor((range[axis] - header->origin[axis]) / header->unit) - 1;
+    high[axis] = ceil((range[axis + 2] - header->origin[axis]) / header->unit) + 1;
+  }
+
+  int capacity = INDEX_BLOCK_RECORDS;
+  int size = 0;
+  indexMatch_t *matches = (indexMatch_t *)malloc(sizeof(indexMatch_t) * capacity);
+  assert(matches);
+  int stack[INDEX_STACK_SIZE];
+  int top = 0;
+  if (header->nodes > 0) {
+    stack[top ++] = 0;
+  }
+  while (top > 0) {
+    indexNode_t *node = &index->nodes[stack[-- top]];
+    if (node->box[2] < low[0] || node->box[0] > high[0] || node->box[3] < low[1] || node->box[1] > high[1]) {
+      continue;
+    }
+    if (node->block == -1) {
+      assert(top + 4 <= INDEX_STACK_SIZE);
+      for (int quadrant = 3; quadrant >= 0; quadrant --) {
+        if (node->children[quadrant] != -1) {
+          stack[top ++] = node->children[quadrant];
+        }
+      }
+      continue;
+    }
+    if (show_blocks) {
+      printf(" block %d", node->block);
+    }
+    int first = records->size;
+    if (decode_block(index, node->block, range) == 0) {
+      continue;
+    }
+    for (int id = first; id < records->size; id ++) {
+      if (!in_range(range, records->start_lon[id], records->start_lat[id]) && 
+      !in_range(range, records->end_lon[id], records->end_lat[id])) {
+        continue;
+      }
+      if (filter != NULL && !filter_matches_record(filter, id)) {
+        continue;
+      }
+      if (size == capacity) {
+        capacity *= 2;
+        matches = (indexMatch_t *)realloc(matches, sizeof(indexMatch_t) * capacity);
+        assert(matches);
+      }
+      matches[size ++] = (indexMatch_t){records->footpath_id[id], id};
+    }
+  }
+
+  /* like remove_duplicate, a footpath_id is given once */
+  qsort(matches, size, sizeof(indexMatch_t), compare_index_match);
+  *results = (uint32_t *)malloc(sizeof(uint32_t) * (size + 1));
+  assert(*results);
+  int count = 0;
+  for (int i = 0; i < size; i ++) {
+    if (i == 0 || matches[i].footpath_id != matches[i - 1].footpath_id) {
+      (*results)[count ++] = matches[i].id;
+    }
+  }
+  free(matches);
+  return count;
+}
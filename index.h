@@ -0,0 +1,91 @@
+#ifndef _INDEX_H_
+#define _INDEX_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* "QTIX" and the version of the compressed index format */
+#define INDEX_MAGIC 0x58495451
+#define INDEX_VERSION 1
+/* a directory cell with at most this many footpaths (by midpoint) becomes a block */
+#define INDEX_BLOCK_RECORDS 64
+/* the quantisation step of the co-ordinates (degrees, about 1 cm) */
+#define INDEX_UNIT 1e-7
+/* the other double columns are stored as hundredths */
+#define INDEX_DECIMAL_SCALE 100.0
+/* a cell of the directory at this level holds a single Morton code */
+#define INDEX_MAX_LEVEL 32
+#define INDEX_STACK_SIZE (3 * INDEX_MAX_LEVEL + 4)
+/* a varint of a 64-bit value takes at most 10 bytes */
+#define MAX_VARINT_BYTES 10
+
+typedef struct byteBuffer byteBuffer_t;
+typedef struct indexHeader indexHeader_t;
+typedef struct indexNode indexNode_t;
+typedef struct indexMatch indexMatch_t;
+typedef struct footpathIndex footpathIndex_t;
+typedef struct recordStore recordStore_t;
+typedef struct attributeFilter attributeFilter_t;
+
+/* a growing array of bytes, read from position */
+struct byteBuffer {
+  unsigned char *bytes;
+  size_t size;
+  size_t capacity;
+  size_t position;
+};
+
+/* the fixed part at the start of an index file, followed by meta_size bytes of varints (the strings, the directory 
+and the size of every block) and the blocks. co-ordinate v is stored as q = round((v - origin) / unit) */
+struct indexHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t records;
+  uint32_t blocks;
+  uint32_t strings;
+  uint32_t nodes;
+  uint64_t meta_size;
+  double origin[2];
+  double unit;
+};
+
+/* a cell of the directory (a quadtree over the Morton codes of the midpoints of the footpaths): the quantised 
+bounding box (bottom left x, y and upper right x, y) of every end point under it, and either its block (a leaf) or 
+its children (-1 for none, block == -1) */
+struct indexNode {
+  uint32_t box[4];
+  int block;
+  int children[4];
+};
+
+/* a footpath found by index_range_query: its footpath_id and its record id in the records of the decoded blocks */
+struct indexMatch {
+  int footpath_id;
+  uint32_t id;
+};
+
+/* a compressed index opened for queries: the directory and the block offsets are kept in memory, the blocks are 
+decoded from a mapping of the file when a query touches them. records holds the records of the blocks decoded by the 
+current query (and the string dictionary of the index) */
+struct footpathIndex {
+  FILE *file;
+  unsigned char *mapping;
+  size_t mapping_size;
+  indexHeader_t header;
+  indexNode_t *nodes;
+  uint64_t *block_offsets;
+  recordStore_t *records;
+  byteBuffer_t block;
+};
+
+void put_varint(byteBuffer_t *buffer, uint64_t value);
+uint64_t get_varint(byteBuffer_t *buffer);
+uint64_t zigzag(int64_t value);
+int64_t unzigzag(uint64_t value);
+void write_index(FILE *output, recordStore_t *records);
+footpathIndex_t *open_index(FILE *input);
+void close_index(footpathIndex_t *index);
+int index_range_query(footpathIndex_t *index, double *range, attributeFilter_t *filter, int show_blocks, 
+uint32_t **results);
+
+#endif
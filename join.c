@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "quadtree.h"
+#include "stats.h"
+#include "records.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "join.h"
+
+struct rectangle2D {
+  point2D_t *bottom_left;
+  point2D_t *upper_right;
+};
+
+struct dataPoint {
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
+};
+
+struct node {
+  dataPoint_t *data_point;
+  node_t *next;
+};
+
+struct quadtreeNode {
+  node_t *head;
+  rectangle2D_t *rectangle;
+  quadtreeNode_t *sw;
+  quadtreeNode_t *nw;
+  quadtreeNode_t *ne;
+  quadtreeNode_t *se;
+  quadtreeNode_t *bucket;
+  quadtreeNode_t *outside;
+  nodeSummary_t summary;
+  nodeAggregate_t aggregate;
+};
+
+/* 
+read every stop of a csv file with the columns id,lon,lat; lines with fewer columns are skipped
+*/
+stopSet_t *read_stops(FILE *input) {
+  stopSet_t *stops = (stopSet_t *)malloc(sizeof(stopSet_t));
+  assert(stops);
+  stops->size = 0;
+  stops->capacity = INITIAL_STOP_CAPACITY;
+  stops->ids = (char **)malloc(sizeof(char *) * stops->capacity);
+  stops->lon = (double *)malloc(sizeof(double) * stops->capacity);
+  stops->lat = (double *)malloc(sizeof(double) * stops->capacity);
+  assert(stops->ids && stops->lon && stops->lat);
+
+  char line[MAX_STOP_LINE_CHAR + 1] = "";
+  /* getting rid of the header line */
+  fscanf(input, "%[^\n] ", line);
+
+  while ((fscanf(input, "%[^\n] ", line)) == 1) {
+    char *fields[STOP_LAT_INDEX + 1];
+    char *end = line;
+    int n = 0;
+    while (n <= STOP_LAT_INDEX && end != NULL) {
+      fields[n ++] = strsep(&end, ",");
+    }
+    if (n <= STOP_LAT_INDEX) {
+      continue;
+    }
+    if (stops->size == stops->capacity) {
+      stops->capacity *= 2;
+      stops->ids = (char **)realloc(stops->ids, sizeof(char *) * stops->capacity);
+      stops->lon = (double *)realloc(stops->lon, sizeof(double) * stops->capacity);
+      stops->lat = (double *)realloc(stops->lat, sizeof(double) * stops->capacity);
+      assert(stops->ids && stops->lon && stops->lat);
+    }
+    stops->ids[stops->size] = strdup(fields[STOP_ID_INDEX]);
+    assert(stops->ids[stops->size]);
+    stops->lon[stops->size] = strtod(fields[STOP_LON_INDEX], NULL);
+    stops->lat[stops->size] = strtod(fields[STOP_LAT_INDEX], NULL);
+    stops->size ++;
+  }
+  return stops;
+}
+
+void free_stops(stopSet_t *stops) {
+  for (int i = 0; i < stops->size; i ++) {
+    free(stops->ids[i]);
+  }
+  free(stops->ids);
+  free(stops->lon);
+  free(stops->lat);
+  free(stops);
+}
+
+/* 
+a spatial join of spatial_join: the footpaths (data points) within distance of each stop are written to output
+*/
+struct joinQuery {
+  double distance;
+  attributeFilter_t *filter;
+  recordStore_t *records;
+  stopSet_t *stops;
+  FILE *output;
+  long pairs;
+};
+
+/* 
+the function returns the squared distance between two points (x1, y1) and (x2, y2)
+*/
+static double squared_distance(double x1, double y1, double x2, double y2) {
+  double dx = x1 - x2;
+  double dy = y1 - y2;
+  return dx * dx + dy * dy;
+}
+
+/* 
+the distance (in longitude or latitude) between the co-ordinates low < high of two rectangles. with 
+-DQUADTREE_FIXED_POINT, a lower bound of the distance between any points of the units of low and high
+*/
+static double coordinate_gap(coordinate_t low, coordinate_t high, int axis) {
+#ifdef QUADTREE_FIXED_POINT
+  return (double)(high - low - 1) * quadtree_unit[axis];
+#else
+  return high - low;
+#endif
+}
+
+/* 
+the function returns the squared distance between the closest points of two rectangles (0 if they overlap)
+*/
+static double rectangle_squared_distance(rectangle2D_t *rec1, rectangle2D_t *rec2) {
+  double dx = 0, dy = 0;
+  if (rec1->upper_right->x < rec2->bottom_left->x) {
+    dx = coordinate_gap(rec1->upper_right->x, rec2->bottom_left->x, X_AXIS);
+  } else if (rec2->upper_right->x < rec1->bottom_left->x) {
+    dx = coordinate_gap(rec2->upper_right->x, rec1->bottom_left->x, X_AXIS);
+  }
+  if (rec1->upper_right->y < rec2->bottom_left->y) {
+    dy = coordinate_gap(rec1->upper_right->y, rec2->bottom_left->y, Y_AXIS);
+  } else if (rec2->upper_right->y < rec1->bottom_left->y) {
+    dy = coordinate_gap(rec2->upper_right->y, rec1->bottom_left->y, Y_AXIS);
+  }
+  return dx * dx + dy * dy;
+}
+
+/* 
+the function writes the (stop, footpath_id) pairs of an occupied leaf node of the footpath quadtree (or its overflow 
+list) and an occupied leaf node of the stop quadtree. the distances are measured on the exact co-ordinates of the 
+records and stops. a footpath with both end points within distance of a stop is written once, at its start point 
+(the end point only writes it if the start point is too far)
+*/
+static void join_leaf_nodes(quadtreeNode_t *footpath_leaf, quadtreeNode_t *stop_leaf, joinQuery_t *join) {
+  double squared_limit = join->distance * join->distance;
+  recordStore_t *records = join->records;
+  for (quadtreeNode_t *leaf = footpath_leaf; leaf != NULL; leaf = leaf->bucket) {
+    for (quadtreeNode_t *stop = stop_leaf; stop != NULL; stop = stop->bucket) {
+      for (node_t *stop_ptr = stop->head; stop_ptr != NULL; stop_ptr = stop_ptr->next) {
+        double stop_x = join->stops->lon[stop_ptr->data_point->record_id];
+        double stop_y = join->stops->lat[stop_ptr->data_point->record_id];
+        for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+          STATS_INC(points_tested);
+          uint32_t id = ptr->data_point->record_id;
+          double x, y;
+          footpath_location(records, ptr->data_point, &x, &y);
+          if (squared_distance(x, y, stop_x, stop_y) > squared_limit) {
+            continue;
+          }
+          if (join->filter != NULL && !filter_matches_record(join->filter, id)) {
+            continue;
+          }
+          if (ptr->data_point->end_point && 
+          squared_distance(records->start_lon[id], records->start_lat[id], stop_x, stop_y) <= squared_limit) {
+            continue;
+          }
+          STATS_INC(points_emitted);
+          fprintf(join->output, "%s,%d\n", join->stops->ids[stop_ptr->data_point->record_id], ptr->data_point->footpath_id);
+          join->pairs ++;
+        }
+      }
+    }
+  }
+}
+
+/* 
+a pair of a footpath node and a stop node the join still has to visit (join_nodes), or a stop node whose stops are 
+still to be joined with the overflow list of the footpath quadtree (join_outside, footpaths is then its root)
+*/
+struct joinFrame {
+  quadtreeNode_t *footpaths;
+  quadtreeNode_t *stops;
+};
+
+/* 
+the function walks the footpath quadtree and the stop quadtree together: a pair of nodes whose rectangles are 
+further apart than the join distance is skipped as a whole, otherwise the larger of the two nodes (or the one that 
+is not a leaf node) is split into its subquadrants. the pairs still to be visited are kept on an explicit stack
+*/
+static void join_nodes(quadtreeNode_t *footpaths, quadtreeNode_t *stops, joinQuery_t *join) {
+  joinFrame_t stack[JOIN_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (joinFrame_t){footpaths, stops};
+  while (top > 0) {
+    joinFrame_t frame = stack[-- top];
+    footpaths = frame.footpaths;
+    stops = frame.stops;
+    STATS_INC(nodes_visited);
+    if (rectangle_squared_distance(footpaths->rectangle, stops->rectangle) > join->distance * join->distance) {
+      continue;
+    }
+    if (footpaths->head != NULL && stops->head != NULL) {
+      STATS_INC(leaves_tested);
+      join_leaf_nodes(footpaths, stops, join);
+      continue;
+    }
+
+    /* the children are pushed in reverse, so they are joined in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= JOIN_STACK_SIZE);
+    double footpaths_width = footpaths->rectangle->upper_right->x - footpaths->rectangle->bottom_left->x;
+    double stops_width = stops->rectangle->upper_right->x - stops->rectangle->bottom_left->x;
+    if (footpaths->head != NULL || (stops->head == NULL && stops_width > footpaths_width)) {
+      for (int quadrant = SE; quadrant >= SW; quadrant --) {
+        quadtreeNode_t *child = get_child(stops, quadrant);
+        if (child != NULL) {
+          stack[top ++] = (joinFrame_t){footpaths, child};
+        }
+      }
+    } else {
+      for (int quadrant = SE; quadrant >= SW; quadrant --) {
+        quadtreeNode_t *child = get_child(footpaths, quadrant);
+        if (child != NULL && subtree_may_match(child, join->filter)) {
+          stack[top ++] = (joinFrame_t){child, stops};
+        }
+      }
+    }
+  }
+}
+
+/* 
+the function joins the overflow list of the footpath quadtree (the locations outside the rectangle of its root) 
+with the stops under the given node of the stop quadtree: outside is the bounding box of the list, the stop nodes 
+further from it than the join distance are skipped
+*/
+static void join_outside(quadtreeNode_t *footpaths, rectangle2D_t *outside, quadtreeNode_t *stops, joinQuery_t *join) {
+  joinFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (joinFrame_t){footpaths, stops};
+  while (top > 0) {
+    stops = stack[-- top].stops;
+    STATS_INC(nodes_visited);
+    if (rectangle_squared_distance(outside, stops->rectangle) > join->distance * join->distance) {
+      continue;
+    }
+    if (stops->head != NULL) {
+      STATS_INC(leaves_tested);
+      join_leaf_nodes(footpaths->outside, stops, join);
+      continue;
+    }
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(stops, quadrant);
+      if (child != NULL) {
+        stack[top ++] = (joinFrame_t){footpaths, child};
+      }
+    }
+  }
+}
+
+/* 
+the function writes a line stop_id,footpath_id to output for every footpath with an end point within distance (in 
+the units of the co-ordinates) of a stop, and returns the number of lines. the stops are indexed in a quadtree of 
+their own bounding box, which is walked together with the footpath quadtree (see join_nodes); the pairs are 
+written in the order they are found. filter is the attribute predicate the footpaths have to match, or NULL
+*/
+long spatial_join(quadtreeNode_t *root, stopSet_t *stops, double distance, attributeFilter_t *filter, 
+recordStore_t *records, FILE *output) {
+  if (stops->size == 0) {
+    return 0;
+  }
+  double min_x = stops->lon[0], min_y = stops->lat[0], max_x = stops->lon[0], max_y = stops->lat[0];
+  for (int i = 1; i < stops->size; i ++) {
+    min_x = (stops->lon[i] < min_x) ? stops->lon[i] : min_x;
+    min_y = (stops->lat[i] < min_y) ? stops->lat[i] : min_y;
+    max_x = (stops->lon[i] > max_x) ? stops->lon[i] : max_x;
+    max_y = (stops->lat[i] > max_y) ? stops->lat[i] : max_y;
+  }
+  quadtreeNode_t *stop_root = create_empty_quadtree(create_rectangle(create_point(min_x, min_y), create_point(max_x, max_y)));
+  /* record_id (and footpath_id, the order of stops sharing a location) is the index of the stop */
+  dataPoint_t *stop_points = (dataPoint_t *)malloc(sizeof(dataPoint_t) * stops->size);
+  assert(stop_points);
+  STATS_ALLOC();
+  /* while the stops are inserted, same_location reads their exact co-ordinates as the start points of a record 
+  store over the stop set */
+  recordStore_t stop_records;
+  memset(&stop_records, 0, sizeof(stop_records));
+  stop_records.start_lon = stops->lon;
+  stop_records.start_lat = stops->lat;
+  recordStore_t *footpath_records = quadtree_records;
+  quadtree_records = &stop_records;
+  for (int i = 0; i < stops->size; i ++) {
+    stop_points[i].record_id = i;
+    stop_points[i].footpath_id = i;
+    stop_points[i].location = point_at(stops->lon[i], stops->lat[i]);
+    stop_points[i].end_point = FALSE;
+    stop_points[i].shared_depth = -1;
+    stop_root = insert_to_quadtree(stop_root, &stop_points[i], stop_root->rectangle, 0);
+  }
+  quadtree_records = footpath_records;
+
+  joinQuery_t join = {distance, filter, records, stops, output, 0};
+  if (root->head != NULL || root->sw != NULL || root->nw != NULL || root->ne != NULL || root->se != NULL) {
+    join_nodes(root, stop_root, &join);
+  }
+  if (root->outside != NULL) {
+    point2D_t bottom_left = root->outside->head->data_point->location;
+    point2D_t upper_right = bottom_left;
+    for (quadtreeNode_t *leaf = root->outside->bucket; leaf != NULL; leaf = leaf->bucket) {
+      point2D_t *location = &leaf->head->data_point->location;
+      bottom_left.x = (location->x < bottom_left.x) ? location->x : bottom_left.x;
+      bottom_left.y = (location->y < bottom_left.y) ? location->y : bottom_left.y;
+      upper_right.x = (location->x > upper_right.x) ? location->x : upper_right.x;
+      upper_right.y = (location->y > upper_right.y) ? location->y : upper_right.y;
+    }
+    rectangle2D_t outside = {&bottom_left, &upper_right};
+    join_outside(root, &outside, stop_root, &join);
+  }
+  free_quadtree(stop_root);
+  free(stop_points);
+  return join.pairs;
+}
@@ -0,0 +1,37 @@
+#ifndef _JOIN_H_
+#define _JOIN_H_
+
+#include <stdio.h>
+
+#define INITIAL_STOP_CAPACITY 1024
+#define MAX_STOP_LINE_CHAR 512
+#define STOP_ID_INDEX 0
+#define STOP_LON_INDEX 1
+#define STOP_LAT_INDEX 2
+/* the pairs of nodes of the join descend one of the two quadtrees at a time, so its walk can be as deep as both 
+quadtrees together */
+#define JOIN_STACK_SIZE (2 * TRAVERSAL_STACK_SIZE)
+
+typedef struct stopSet stopSet_t;
+typedef struct joinQuery joinQuery_t;
+typedef struct joinFrame joinFrame_t;
+typedef struct quadtreeNode quadtreeNode_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+
+/* the points of a spatial join (bus stops, ramps, ...), read from a csv file with a header line and the columns 
+id,lon,lat (further columns are ignored) */
+struct stopSet {
+  int size;
+  int capacity;
+  char **ids;
+  double *lon;
+  double *lat;
+};
+
+stopSet_t *read_stops(FILE *input);
+void free_stops(stopSet_t *stops);
+long spatial_join(quadtreeNode_t *root, stopSet_t *stops, double distance, attributeFilter_t *filter, 
+recordStore_t *records, FILE *output);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <limits.h>
+#include "quadtree.h"
+#include "stats.h"
+#include "records.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "page.h"
+
+struct dataPoint {
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
+};
+
+struct node {
+  dataPoint_t *data_point;
+  node_t *next;
+};
+
+struct quadtreeNode {
+  node_t *head;
+  rectangle2D_t *rectangle;
+  quadtreeNode_t *sw;
+  quadtreeNode_t *nw;
+  quadtreeNode_t *ne;
+  quadtreeNode_t *se;
+  quadtreeNode_t *bucket;
+  quadtreeNode_t *outside;
+  nodeSummary_t summary;
+  nodeAggregate_t aggregate;
+};
+
+/* 
+an entry of the priority queue of page_query: a quadtree node or a data point, keyed by the smallest footpath_id 
+above the cursor it can hold
+*/
+struct pageEntry {
+  int key;
+  quadtreeNode_t *node;
+  dataPoint_t *data_point;
+};
+
+/* 
+a binary min-heap of page entries
+*/
+struct pageHeap {
+  pageEntry_t *entries;
+  int size;
+  int capacity;
+};
+
+/* 
+the function returns a lower bound of the footpath_ids above cursor that are stored under the given node, or 
+INT_MAX if there is none. the bound is the smallest id of the first id range present in the node that is not 
+entirely below the cursor
+*/
+static int page_lower_bound(quadtreeNode_t *node, recordStore_t *records, int cursor) {
+  nodeSummary_t *summary = &node->summary;
+  if (summary->max_footpath_id <= cursor) {
+    return INT_MAX;
+  }
+  int first = cursor + 1;
+  if (first <= summary->min_footpath_id) {
+    return summary->min_footpath_id;
+  }
+  int range = id_range(records, first);
+  uint64_t later = summary->id_ranges & (~0ULL << range);
+  if (later == 0) {
+    return INT_MAX;
+  }
+  int next = __builtin_ctzll(later);
+  return (next == range) ? first : records->id_bounds[next];
+}
+
+/* 
+insert a node (data_point == NULL) or a data point (node == NULL) into the heap
+*/
+static void push_page_entry(pageHeap_t *heap, int key, quadtreeNode_t *node, dataPoint_t *data_point) {
+  if (heap->size == heap->capacity) {
+    heap->capacity = (heap->capacity == 0) ? INITIAL_PAGE_HEAP : 2 * heap->capacity;
+    heap->entries = (pageEntry_t *)realloc(heap->entries, sizeof(pageEntry_t) * heap->capacity);
+    assert(heap->entries);
+    STATS_ALLOC();
+  }
+  int i = heap->size ++;
+  while (i > 0 && heap->entries[(i - 1) / 2].key > key) {
+    heap->entries[i] = heap->entries[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap->entries[i].key = key;
+  heap->entries[i].node = node;
+  heap->entries[i].data_point = data_point;
+}
+
+/* 
+remove the entry with the smallest key from a non-empty heap and return it
+*/
+static pageEntry_t pop_page_entry(pageHeap_t *heap) {
+  pageEntry_t top = heap->entries[0];
+  pageEntry_t last = heap->entries[-- heap->size];
+  int i = 0;
+  while (2 * i + 1 < heap->size) {
+    int child = 2 * i + 1;
+    if (child + 1 < heap->size && heap->entries[child + 1].key < heap->entries[child].key) {
+      child ++;
+    }
+    if (heap->entries[child].key >= last.key) {
+      break;
+    }
+    heap->entries[i] = heap->entries[child];
+    i = child;
+  }
+  heap->entries[i] = last;
+  return top;
+}
+
+/* 
+push the data points of a leaf node and its overflow bucket (or of the overflow list of the root) that lie within 
+the range rectangle, match the filter (if any) and have a footpath_id above cursor into the heap
+*/
+static void push_page_locations(pageHeap_t *heap, quadtreeNode_t *leaf, rectangle2D_t *range_rectangle, 
+attributeFilter_t *filter, int cursor) {
+  for (; leaf != NULL; leaf = leaf->bucket) {
+    STATS_LEAF(list_length(leaf->head));
+    STATS_INC(points_tested);
+    if (!in_rectangle(range_rectangle, &leaf->head->data_point->location)) {
+      continue;
+    }
+    for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+      if (ptr->data_point->footpath_id <= cursor || 
+      (filter != NULL && !filter_matches_record(filter, ptr->data_point->record_id))) {
+        continue;
+      }
+      push_page_entry(heap, ptr->data_point->footpath_id, NULL, ptr->data_point);
+    }
+  }
+}
+
+/* 
+the function returns one page of the footpaths within the range rectangle (the same footpaths as range_query) in 
+ascending footpath_id order: the record ids of at most limit footpaths whose footpath_id is above cursor are 
+written to results, and their number is returned. nodes are searched in the order of their lower bound 
+(page_lower_bound), so the search stops as soon as the page is full and only the subtrees that can hold the ids 
+of this page are visited. filter is the attribute predicate the records have to match, or NULL for none
+*/
+int page_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, recordStore_t *records, 
+int cursor, int limit, uint32_t *results) {
+  pageHeap_t heap = {NULL, 0, 0};
+  int count = 0;
+  int last_id = cursor;
+  push_page_locations(&heap, root->outside, range_rectangle, filter, cursor);
+  if (root->head != NULL || root->sw != NULL || root->nw != NULL || root->ne != NULL || root->se != NULL) {
+    push_page_entry(&heap, page_lower_bound(root, records, cursor), root, NULL);
+  }
+  while (heap.size > 0 && count < limit) {
+    pageEntry_t entry = pop_page_entry(&heap);
+    if (entry.key == INT_MAX) {
+      break;
+    }
+    /* every entry left holds ids of at least entry.key, the data point is the next footpath of the page (its other 
+    end point has the same key, so it is skipped) */
+    if (entry.data_point != NULL) {
+      if (entry.key != last_id) {
+        results[count ++] = entry.data_point->record_id;
+        last_id = entry.key;
+        STATS_INC(points_emitted);
+      }
+      continue;
+    }
+
+    quadtreeNode_t *node = entry.node;
+    STATS_INC(nodes_visited);
+    if (node->head != NULL) {
+      push_page_locations(&heap, node, range_rectangle, filter, cursor);
+      continue;
+    }
+    quadtreeNode_t *children[] = {node->sw, node->nw, node->ne, node->se};
+    for (int i = 0; i < 4; i ++) {
+      if (children[i] != NULL && rectangle_overlap(children[i]->rectangle, range_rectangle) && 
+      subtree_may_match(children[i], filter)) {
+        int key = page_lower_bound(children[i], records, cursor);
+        if (key != INT_MAX) {
+          push_page_entry(&heap, key, children[i], NULL);
+        }
+      }
+    }
+  }
+  free(heap.entries);
+  return count;
+}
@@ -0,0 +1,19 @@
+#ifndef _PAGE_H_
+#define _PAGE_H_
+
+#include <stdint.h>
+
+/* initial number of entries of the priority queue of page_query */
+#define INITIAL_PAGE_HEAP 256
+
+typedef struct quadtreeNode quadtreeNode_t;
+typedef struct rectangle2D rectangle2D_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+typedef struct pageEntry pageEntry_t;
+typedef struct pageHeap pageHeap_t;
+
+int page_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, recordStore_t *records, 
+int cursor, int limit, uint32_t *results);
+
+#endif
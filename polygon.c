@@ -0,0 +1,398 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "quadtree.h"
+#include "stats.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "polygon.h"
+
+struct dataPoint {
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
+};
+
+struct node {
+  dataPoint_t *data_point;
+  node_t *next;
+};
+
+struct quadtreeNode {
+  node_t *head;
+  rectangle2D_t *rectangle;
+  quadtreeNode_t *sw;
+  quadtreeNode_t *nw;
+  quadtreeNode_t *ne;
+  quadtreeNode_t *se;
+  quadtreeNode_t *bucket;
+  quadtreeNode_t *outside;
+  nodeSummary_t summary;
+  nodeAggregate_t aggregate;
+};
+
+/* 
+the band of the polygon that holds the latitude y; latitudes outside the bounding box are given the first or last band
+*/
+int band_of(polygon_t *polygon, double y) {
+  int band = (int)((y - polygon->bounds[1]) / polygon->band_height);
+  if (band < 0) {
+    return 0;
+  }
+  return (band >= polygon->bands) ? polygon->bands - 1 : band;
+}
+
+/* 
+index the edges of the polygon by latitude: one band per edge, so an edge is listed in about one band on average
+*/
+void index_polygon_edges(polygon_t *polygon) {
+  polygon->bands = polygon->size;
+  polygon->band_height = (polygon->bounds[3] - polygon->bounds[1]) / polygon->bands;
+  if (polygon->band_height <= 0) {
+    polygon->bands = 1;
+    polygon->band_height = 1;
+  }
+  polygon->band_start = (int *)calloc(polygon->bands + 1, sizeof(int));
+  assert(polygon->band_start);
+
+  /* count the edges of every band, then turn the counts into offsets and fill the bands */
+  for (int i = 0; i < polygon->size; i ++) {
+    int j = (i + 1) % polygon->size;
+    int low = band_of(polygon, (polygon->y[i] < polygon->y[j]) ? polygon->y[i] : polygon->y[j]);
+    int high = band_of(polygon, (polygon->y[i] > polygon->y[j]) ? polygon->y[i] : polygon->y[j]);
+    for (int band = low; band <= high; band ++) {
+      polygon->band_start[band + 1] ++;
+    }
+  }
+  for (int band = 0; band < polygon->bands; band ++) {
+    polygon->band_start[band + 1] += polygon->band_start[band];
+  }
+  polygon->band_edges = (int *)malloc(sizeof(int) * polygon->band_start[polygon->bands]);
+  int *filled = (int *)calloc(polygon->bands, sizeof(int));
+  assert(polygon->band_edges && filled);
+  for (int i = 0; i < polygon->size; i ++) {
+    int j = (i + 1) % polygon->size;
+    int low = band_of(polygon, (polygon->y[i] < polygon->y[j]) ? polygon->y[i] : polygon->y[j]);
+    int high = band_of(polygon, (polygon->y[i] > polygon->y[j]) ? polygon->y[i] : polygon->y[j]);
+    for (int band = low; band <= high; band ++) {
+      polygon->band_edges[polygon->band_start[band] + filled[band] ++] = i;
+    }
+  }
+  free(filled);
+}
+
+/* 
+build a polygon from its id and the co-ordinates of its vertices (lon1, lat1, lon2, lat2, ...); a last vertex that 
+repeats the first one is dropped. returns NULL if there are fewer than three vertices
+*/
+polygon_t *create_polygon(char *id, double *coordinates, int n) {
+  int size = n / 2;
+  if (size > 1 && coordinates[0] == coordinates[2 * size - 2] && coordinates[1] == coordinates[2 * size - 1]) {
+    size --;
+  }
+  if (size < MIN_POLYGON_VERTICES) {
+    return NULL;
+  }
+  polygon_t *polygon = (polygon_t *)malloc(sizeof(polygon_t));
+  assert(polygon);
+  polygon->id = strdup(id);
+  polygon->size = size;
+  polygon->x = (double *)malloc(sizeof(double) * size);
+  polygon->y = (double *)malloc(sizeof(double) * size);
+  assert(polygon->id && polygon->x && polygon->y);
+  for (int i = 0; i < size; i ++) {
+    polygon->x[i] = coordinates[2 * i];
+    polygon->y[i] = coordinates[2 * i + 1];
+  }
+  polygon->bounds[0] = polygon->bounds[2] = polygon->x[0];
+  polygon->bounds[1] = polygon->bounds[3] = polygon->y[0];
+  for (int i = 1; i < size; i ++) {
+    polygon->bounds[0] = (polygon->x[i] < polygon->bounds[0]) ? polygon->x[i] : polygon->bounds[0];
+    polygon->bounds[1] = (polygon->y[i] < polygon->bounds[1]) ? polygon->y[i] : polygon->bounds[1];
+    polygon->bounds[2] = (polygon->x[i] > polygon->bounds[2]) ? polygon->x[i] : polygon->bounds[2];
+    polygon->bounds[3] = (polygon->y[i] > polygon->bounds[3]) ? polygon->y[i] : polygon->bounds[3];
+  }
+  index_polygon_edges(polygon);
+  return polygon;
+}
+
+/* 
+read every polygon of a csv file with a header line and the columns id,lon1,lat1,lon2,lat2,...; lines with fewer 
+than three vertices are skipped
+*/
+polygonSet_t *read_polygons(FILE *input) {
+  polygonSet_t *polygons = (polygonSet_t *)malloc(sizeof(polygonSet_t));
+  assert(polygons);
+  polygons->size = 0;
+  polygons->capacity = INITIAL_POLYGON_CAPACITY;
+  polygons->polygons = (polygon_t **)malloc(sizeof(polygon_t *) * polygons->capacity);
+  assert(polygons->polygons);
+
+  /* a boundary can have any number of vertices, so the lines have no length limit */
+  char *line = NULL;
+  size_t line_size = 0;
+  int capacity = 2 * INITIAL_POLYGON_CAPACITY;
+  double *coordinates = (double *)malloc(sizeof(double) * capacity);
+  assert(coordinates);
+  /* getting rid of the header line */
+  int header = 1;
+  while (getline(&line, &line_size, input) != -1) {
+    if (header) {
+      header = 0;
+      continue;
+    }
+    line[strcspn(line, "\r\n")] = '\0';
+    char *end = line;
+    char *id = strsep(&end, ",");
+    int n = 0;
+    while (end != NULL) {
+      char *field = strsep(&end, ",");
+      if (n == capacity) {
+        capacity *= 2;
+        coordinates = (double *)realloc(coordinates, sizeof(double) * capacity);
+        assert(coordinates);
+      }
+      coordinates[n ++] = strtod(field, NULL);
+    }
+    polygon_t *polygon = create_polygon(id, coordinates, n);
+    if (polygon == NULL) {
+      continue;
+    }
+    if (polygons->size == polygons->capacity) {
+      polygons->capacity *= 2;
+      polygons->polygons = (polygon_t **)realloc(polygons->polygons, sizeof(polygon_t *) * polygons->capacity);
+      assert(polygons->polygons);
+    }
+    polygons->polygons[polygons->size ++] = polygon;
+  }
+  free(coordinates);
+  free(line);
+  return polygons;
+}
+
+void free_polygons(polygonSet_t *polygons) {
+  for (int i = 0; i < polygons->size; i ++) {
+    polygon_t *polygon = polygons->polygons[i];
+    free(polygon->id);
+    free(polygon->x);
+    free(polygon->y);
+    free(polygon->band_start);
+    free(polygon->band_edges);
+    free(polygon);
+  }
+  free(polygons->polygons);
+  free(polygons);
+}
+
+/* 
+returns 1 if the point (x, y) lies within the polygon (even-odd rule: a ray from the point towards increasing x 
+crosses its edges an odd number of times). only the edges of the band of y are tested: an edge that crosses the ray 
+overlaps the latitude y, so it is listed in that band
+*/
+int in_polygon(polygon_t *polygon, double x, double y) {
+  if (x < polygon->bounds[0] || x > polygon->bounds[2] || y < polygon->bounds[1] || y > polygon->bounds[3]) {
+    return 0;
+  }
+  int band = band_of(polygon, y);
+  int inside = 0;
+  for (int k = polygon->band_start[band]; k < polygon->band_start[band + 1]; k ++) {
+    int i = polygon->band_edges[k];
+    int j = (i + 1) % polygon->size;
+    double xi = polygon->x[i], yi = polygon->y[i], xj = polygon->x[j], yj = polygon->y[j];
+    if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+/* 
+returns 1 if the segment from (x1, y1) to (x2, y2) touches the (closed) rectangle area: their bounding boxes overlap 
+and the corners of the rectangle do not all lie strictly on one side of the line through the segment
+*/
+int segment_touches_rectangle(double x1, double y1, double x2, double y2, double *area) {
+  if (((x1 < x2) ? x2 : x1) < area[0] || ((x1 < x2) ? x1 : x2) > area[2] || 
+  ((y1 < y2) ? y2 : y1) < area[1] || ((y1 < y2) ? y1 : y2) > area[3]) {
+    return 0;
+  }
+  int above = 0, below = 0;
+  double corners[4][2] = {{area[0], area[1]}, {area[0], area[3]}, {area[2], area[3]}, {area[2], area[1]}};
+  for (int c = 0; c < 4; c ++) {
+    double side = (x2 - x1) * (corners[c][1] - y1) - (y2 - y1) * (corners[c][0] - x1);
+    above += (side >= 0);
+    below += (side <= 0);
+  }
+  return above > 0 && below > 0;
+}
+
+/* 
+classify the rectangle area (bottom left x, bottom left y, upper right x, upper right y) against the polygon: 
+POLYGON_CROSSING if an edge touches it, otherwise POLYGON_INSIDE or POLYGON_OUTSIDE, as the rectangle then lies 
+entirely on one side of the boundary and one of its corners tells which. only the edges of the bands the rectangle 
+overlaps are tested
+*/
+int classify_rectangle(polygon_t *polygon, double *area) {
+  if (area[2] < polygon->bounds[0] || area[0] > polygon->bounds[2] || 
+  area[3] < polygon->bounds[1] || area[1] > polygon->bounds[3]) {
+    return POLYGON_OUTSIDE;
+  }
+  int low = band_of(polygon, area[1]);
+  int high = band_of(polygon, area[3]);
+  for (int band = low; band <= high; band ++) {
+    for (int k = polygon->band_start[band]; k < polygon->band_start[band + 1]; k ++) {
+      int i = polygon->band_edges[k];
+      int j = (i + 1) % polygon->size;
+      if (segment_touches_rectangle(polygon->x[i], polygon->y[i], polygon->x[j], polygon->y[j], area)) {
+        return POLYGON_CROSSING;
+      }
+    }
+  }
+  return (in_polygon(polygon, area[0], area[1])) ? POLYGON_INSIDE : POLYGON_OUTSIDE;
+}
+
+/* 
+a node a polygon query still has to visit, with its depth and whether its rectangle is already known to lie within 
+the polygon (then every data point under it matches without a test)
+*/
+struct polygonFrame {
+  quadtreeNode_t *node;
+  int depth;
+  int inside;
+};
+
+/* 
+a polygon query of polygon_query: the data points found so far, and the number of cells (node rectangles) found 
+outside, inside and crossing the polygon
+*/
+struct polygonQuery {
+  polygon_t *polygon;
+  attributeFilter_t *filter;
+  recordStore_t *records;
+  dataPoint_t **matches;
+  int size;
+  int capacity;
+  long *cells;
+};
+
+/* 
+orders two data points (dataPoint_t *) by footpath_id, then by record id
+*/
+static int compare_footpath_id(const void *a, const void *b) {
+  dataPoint_t *p1 = *(dataPoint_t **)a;
+  dataPoint_t *p2 = *(dataPoint_t **)b;
+  if (p1->footpath_id != p2->footpath_id) {
+    return (p1->footpath_id < p2->footpath_id) ? -1 : 1;
+  }
+  return (p1->record_id < p2->record_id) ? -1 : (p1->record_id > p2->record_id);
+}
+
+/* 
+add a data point to the matches of a polygon query
+*/
+static void push_polygon_match(polygonQuery_t *query, dataPoint_t *data_point) {
+  if (query->size == query->capacity) {
+    query->capacity = (query->capacity == 0) ? RANGE_BATCH_SIZE : 2 * query->capacity;
+    query->matches = (dataPoint_t **)realloc(query->matches, sizeof(dataPoint_t *) * query->capacity);
+    assert(query->matches);
+    STATS_ALLOC();
+  }
+  STATS_INC(points_emitted);
+  query->matches[query->size ++] = data_point;
+}
+
+/* 
+add the data points of a leaf node and its overflow bucket (or of the overflow list of the root) that match the 
+filter (if any) and lie within the polygon: all of them if the leaf is inside it, otherwise the exact co-ordinates 
+of every data point are tested
+*/
+static void match_polygon_locations(polygonQuery_t *query, quadtreeNode_t *leaf, int inside) {
+  attributeFilter_t *filter = query->filter;
+  for (; leaf != NULL; leaf = leaf->bucket) {
+    STATS_LEAF(list_length(leaf->head));
+    if (filter != NULL && !filter_may_match(filter, &leaf->summary)) {
+      STATS_INC(subtrees_pruned);
+      continue;
+    }
+    for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+      if (filter != NULL && !filter_matches_record(filter, ptr->data_point->record_id)) {
+        continue;
+      }
+      if (!inside) {
+        double x, y;
+        footpath_location(query->records, ptr->data_point, &x, &y);
+        STATS_INC(points_tested);
+        if (!in_polygon(query->polygon, x, y)) {
+          continue;
+        }
+      }
+      push_polygon_match(query, ptr->data_point);
+    }
+  }
+}
+
+/* 
+the function returns the footpaths with an end point within the polygon that match the filter (NULL for none): the 
+record ids are written to a new array *results (to be freed by the caller) in ascending footpath_id order, each 
+footpath once, and their number is returned. every node rectangle on the way is classified against the polygon: an 
+outside node is skipped with its subtree, an inside node gives every data point under it without a test, and only 
+the leaves of crossing nodes test their data points exactly. cells (if not NULL) counts the nodes of each class 
+(POLYGON_OUTSIDE, POLYGON_INSIDE, POLYGON_CROSSING)
+*/
+int polygon_query(quadtreeNode_t *root, polygon_t *polygon, attributeFilter_t *filter, recordStore_t *records, 
+uint32_t **results, long *cells) {
+  long counted[3] = {0, 0, 0};
+  polygonQuery_t query = {polygon, filter, records, NULL, 0, 0, (cells != NULL) ? cells : counted};
+  /* the overflow list of the root has no rectangle, its data points are tested one by one */
+  STATS_DEPTH(0);
+  match_polygon_locations(&query, root->outside, FALSE);
+
+  polygonFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (polygonFrame_t){root, 0, FALSE};
+  while (top > 0) {
+    polygonFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(frame.depth);
+    if (!frame.inside) {
+      double area[4];
+      rectangle_area(node->rectangle, area);
+      int class = classify_rectangle(polygon, area);
+      query.cells[class] ++;
+      if (class == POLYGON_OUTSIDE) {
+        continue;
+      }
+      frame.inside = (class == POLYGON_INSIDE);
+    }
+    if (node->head != NULL) {
+      match_polygon_locations(&query, node, frame.inside);
+      continue;
+    }
+    /* the children are pushed in reverse, so they are searched in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && subtree_may_match(child, filter)) {
+        stack[top ++] = (polygonFrame_t){child, frame.depth + 1, frame.inside};
+      }
+    }
+  }
+
+  /* a footpath with both end points within the polygon is found twice */
+  qsort(query.matches, query.size, sizeof(dataPoint_t *), compare_footpath_id);
+  *results = (uint32_t *)malloc(sizeof(uint32_t) * (query.size + 1));
+  assert(*results);
+  int count = 0;
+  for (int i = 0; i < query.size; i ++) {
+    if (i == 0 || query.matches[i]->footpath_id != query.matches[i - 1]->footpath_id) {
+      (*results)[count ++] = query.matches[i]->record_id;
+    }
+  }
+  free(query.matches);
+  return count;
+}
@@ -0,0 +1,57 @@
+#ifndef _POLYGON_H_
+#define _POLYGON_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define INITIAL_POLYGON_CAPACITY 16
+#define POLYGON_ID_INDEX 0
+/* a polygon needs at least three vertices */
+#define MIN_POLYGON_VERTICES 3
+
+/* how a rectangle lies relative to a polygon (classify_rectangle) */
+#define POLYGON_OUTSIDE 0
+#define POLYGON_INSIDE 1
+#define POLYGON_CROSSING 2
+
+typedef struct polygon polygon_t;
+typedef struct polygonSet polygonSet_t;
+typedef struct polygonFrame polygonFrame_t;
+typedef struct polygonQuery polygonQuery_t;
+typedef struct quadtreeNode quadtreeNode_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+
+/* a simple polygon (a suburb or ward boundary): edge i runs from vertex i to vertex i + 1 (the last one back to the 
+first). the edges are indexed by latitude: the bounding box is cut into bands of the same height, and band k lists 
+(in band_edges[band_start[k]] to band_edges[band_start[k + 1] - 1]) every edge whose latitudes overlap it, so a 
+point or rectangle is only tested against the edges of the bands it lies in */
+struct polygon {
+  char *id;
+  int size;
+  double *x;
+  double *y;
+  /* bottom left x, bottom left y, upper right x, upper right y */
+  double bounds[4];
+  int bands;
+  double band_height;
+  int *band_start;
+  int *band_edges;
+};
+
+/* the polygons of a polygon query, read from a csv file with a header line and one polygon per line: 
+id,lon1,lat1,lon2,lat2,... */
+struct polygonSet {
+  int size;
+  int capacity;
+  polygon_t **polygons;
+};
+
+polygonSet_t *read_polygons(FILE *input);
+void free_polygons(polygonSet_t *polygons);
+int in_polygon(polygon_t *polygon, double x, double y);
+int classify_rectangle(polygon_t *polygon, double *area);
+int polygon_query(quadtreeNode_t *root, polygon_t *polygon, attributeFilter_t *filter, recordStore_t *records, 
+uint32_t **results, long *cells);
+
+#endif
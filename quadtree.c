@@ -2,14 +2,17 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
 #include "data.h"
 #include "dict.h"
 #include "quadtree.h"
-
-struct point2D {
-  double x;
-  double y;
-};
+#include "stats.h"
+#include "records.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "arena.h"
 
 struct rectangle2D {
   point2D_t *bottom_left;
@@ -17,8 +20,14 @@ struct rectangle2D {
 };
 
 struct dataPoint {
-  data_t *data;
-  point2D_t *location;
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  /* end_point: TRUE for the end (lon/lat) of a footpath; shared_depth: the depth of the deepest quadtree node that
+  holds both end points of the footpath (-1 if the start point is not in the quadtree, SHARED_LEAF if they share
+  a leaf node), set by add_to_summaries */
+  uint8_t end_point;
+  int16_t shared_depth;
 };
 
 struct node {
@@ -26,32 +35,12 @@ struct node {
   node_t *next;
 };
 
-struct data {
-  int footpath_id;
-  char *address;
-  char *clue_sa;
-  char *asset_type;
-  double deltaz;
-  double distance;
-  double gradelin;
-  int mcc_id;
-  int mccid_int;
-  double rlmax;
-  double rlmin;
-  char *segside;
-  int statusid;
-  int streetid;
-  int street_group;
-  double start_lat;
-  double start_lon;
-  double end_lat;
-  double end_lon;
-};
-
 struct list {
   node_t *head;
   node_t *tail;
   int size;
+  recordStore_t *records;
+  double bounds[4];
 };
 
 struct quadtreeNode {
@@ -62,20 +51,101 @@ struct quadtreeNode {
   quadtreeNode_t *nw;
   quadtreeNode_t *ne;
   quadtreeNode_t *se;
+  /* next location in an overflow bucket: a leaf that reached the depth/cell size limits keeps each further
+  location in its own chained node (rectangle == NULL) instead of splitting */
+  quadtreeNode_t *bucket;
+  /* the data points outside the rectangle of the root (only used at the root): one chained node per location
+  (rectangle == NULL), like an overflow bucket, so they are still found by every query */
+  quadtreeNode_t *outside;
+  /* attributes of every data point under this node (for a leaf node: its linked list and overflow bucket), 
+  used by filtered range queries to skip subtrees that cannot match */
+  nodeSummary_t summary;
+  /* count and sums of the footpaths under this node, used by aggregate_query */
+  nodeAggregate_t aggregate;
 };
 
+/* 
+the depth and cell size limits of the quadtree, a leaf node that reaches either one is not split any further
+and becomes an overflow bucket (see insert_to_quadtree). they can be changed with set_quadtree_limits
+*/
+int quadtree_max_depth = DEFAULT_MAX_DEPTH;
+double quadtree_min_cell_size = DEFAULT_MIN_CELL_SIZE;
+
+/* 
+the root area of the fixed-point co-ordinates (bottom left x, bottom left y, upper right x, upper right y) and the 
+width and height of one unit, set by set_quadtree_frame
+*/
+double quadtree_frame[4] = {0, 0, FIXED_ROOT, FIXED_ROOT};
+double quadtree_unit[2] = {1, 1};
+
+/* 
+the records the exact co-ordinates of the data points are read from (see exact_location), set by make_quadtree. 
+with -DQUADTREE_FIXED_POINT a location only routes a data point, whether two are at the same place is decided on 
+these doubles
+*/
+recordStore_t *quadtree_records = NULL;
+
+/* 
+set the root area the points are created relative to. with -DQUADTREE_FIXED_POINT it has to be set before the first 
+point is created (create_point), and every later point is mapped onto the fixed-point grid of this area
+*/
+void set_quadtree_frame(double *area) {
+  memcpy(quadtree_frame, area, sizeof(quadtree_frame));
+  for (int axis = X_AXIS; axis <= Y_AXIS; axis ++) {
+    double extent = area[axis + 2] - area[axis];
+    quadtree_unit[axis] = (extent > 0) ? extent / FIXED_ROOT : 1;
+  }
+}
+
+/* 
+convert a longitude (axis X_AXIS) or latitude (Y_AXIS) into a co-ordinate. with -DQUADTREE_FIXED_POINT, the value 
+is rounded down to the fixed-point grid of the frame; a value within the frame (boundaries included) stays within 
+[FIXED_ROOT, 2 * FIXED_ROOT - 1] and a value outside of it stays outside, so in_rectangle on the root gives the same 
+answer as on the doubles. values further out are clamped to the representable range
+*/
+coordinate_t to_coordinate(double value, int axis) {
+#ifdef QUADTREE_FIXED_POINT
+  double origin = quadtree_frame[axis];
+  double end = quadtree_frame[axis + 2];
+  double offset = floor((value - origin) / quadtree_unit[axis]);
+  if (value < origin) {
+    offset = (offset > -1) ? -1 : offset;
+  } else if (value <= end) {
+    offset = (offset > FIXED_ROOT - 1) ? FIXED_ROOT - 1 : offset;
+  } else {
+    offset = (offset < FIXED_ROOT) ? FIXED_ROOT : offset;
+  }
+  offset += FIXED_ROOT;
+  return (offset <= 0) ? 0 : (offset >= UINT32_MAX) ? UINT32_MAX : (coordinate_t)offset;
+#else
+  return value;
+#endif
+}
+
+/* 
+convert a co-ordinate back into a longitude (axis X_AXIS) or latitude (Y_AXIS), for a fixed-point co-ordinate the 
+lower boundary of its unit
+*/
+double from_coordinate(coordinate_t value, int axis) {
+#ifdef QUADTREE_FIXED_POINT
+  return quadtree_frame[axis] + ((double)value - FIXED_ROOT) * quadtree_unit[axis];
+#else
+  return value;
+#endif
+}
+
 
 /* 
 tests whether a given 2D point lies within the rectangle and returns 1 (True) if it does. Otherwise, 
 return 0 (False) 
 */
 int in_rectangle(rectangle2D_t *rec, point2D_t *point) {
-  double x = point->x;
-  double y = point->y;
-  double left_bound = rec->bottom_left->x;
-  double bot_bound = rec->bottom_left->y;
-  double right_bound = rec->upper_right->x;
-  double up_bound = rec->upper_right->y;
+  coordinate_t x = point->x;
+  coordinate_t y = point->y;
+  coordinate_t left_bound = rec->bottom_left->x;
+  coordinate_t bot_bound = rec->bottom_left->y;
+  coordinate_t right_bound = rec->upper_right->x;
+  coordinate_t up_bound = rec->upper_right->y;
   if (x >= left_bound && x <= right_bound && y >= bot_bound && y <= up_bound) {
     return TRUE;
   }
@@ -83,14 +153,18 @@ int in_rectangle(rectangle2D_t *rec, point2D_t *point) {
 }
 
 /* 
-create an empty quadtree node as the root of the quadtree
+create an empty quadtree node as the root of the quadtree, over node_area (see align_cell)
 */
 quadtreeNode_t *create_empty_quadtree(rectangle2D_t *node_area) {
-  quadtreeNode_t *tree = (quadtreeNode_t *)malloc(sizeof(quadtreeNode_t));
-  assert(tree);
+  quadtreeNode_t *tree = (quadtreeNode_t *)tree_alloc(sizeof(quadtreeNode_t));
+  STATS_ALLOC();
+  align_cell(node_area);
   tree->rectangle = node_area;
   tree->head = NULL;
   tree->sw = tree->nw = tree->ne = tree->se = NULL;
+  tree->bucket = tree->outside = NULL;
+  empty_summary(&tree->summary);
+  empty_aggregate(&tree->aggregate);
   return tree;
 }
 
@@ -107,39 +181,92 @@ int rectangle_overlap(rectangle2D_t *rec1, rectangle2D_t *rec2) {
   return TRUE;
 }
 
-/*  
-check if the point is located inside the selected quadrant of the given rectangle
+/* 
+given a rectangle, determine which quadrant the given point belongs to 
 */
-int in_quadrant(rectangle2D_t *rec, point2D_t *point, int quadrant_code) {
-  assert(quadrant_code >= SW && quadrant_code <= SE);
-  int result = FALSE;
-  rectangle2D_t *quadrant = get_quadrant(rec, quadrant_code);
-  /* check if the point is in the quadrant */
-  if (in_rectangle(quadrant, point)) {
-    result = TRUE;
+int determine_quadrant(rectangle2D_t *rec, point2D_t *point) {
+  coordinate_t x = point->x;
+  coordinate_t y = point->y;
+  if (x < rec->bottom_left->x || x > rec->upper_right->x || y < rec->bottom_left->y || y > rec->upper_right->y) {
+    /* the data points outside the root are kept in its overflow list (see insert_outside), so only a 
+    query can reach -1 */
+    return -1;
   }
-  free(quadrant->bottom_left);
-  free(quadrant->upper_right);
-  free(quadrant);
-  return result;
+#ifdef QUADTREE_FIXED_POINT
+  /* the rectangle is an aligned cell of the fixed-point grid (see align_cell), so the quadrant is the next bit of 
+  x and y */
+  static const int quadrants[2][2] = {{SW, NW}, {SE, NE}};
+  coordinate_t half_x = (rec->upper_right->x - rec->bottom_left->x) / 2 + 1;
+  coordinate_t half_y = (rec->upper_right->y - rec->bottom_left->y) / 2 + 1;
+  return quadrants[(x & half_x) != 0][(y & half_y) != 0];
+#else
+  /* same midpoint as get_quadrant, points on a boundary go to the first quadrant in the SW, NW, NE, SE order 
+  (the same result as testing in_rectangle on each quadrant in turn, without creating the quadrants) */
+  double mid_x = (rec->upper_right->x + rec->bottom_left->x) / 2;
+  double mid_y = (rec->upper_right->y + rec->bottom_left->y) / 2;
+  if (x <= mid_x) {
+    return (y <= mid_y) ? SW : NW;
+  }
+  return (y >= mid_y) ? NE : SE;
+#endif
 }
 
 /* 
-given a rectangle, determine which quadrant the given point belongs to 
+the last co-ordinate of the lower (west or south) half of [low, high]: the midpoint, shared by both halves, or with 
+-DQUADTREE_FIXED_POINT the last unit of the lower half
 */
-int determine_quadrant(rectangle2D_t *rec, point2D_t *point) {
-  if (in_quadrant(rec, point, SW)) {
-    return SW;
-  } else if (in_quadrant(rec, point, NW)) {
-    return NW;
-  } else if (in_quadrant(rec, point, NE)) {
-    return NE;
-  } else if (in_quadrant(rec, point, SE)) {
-    return SE;
+coordinate_t lower_half_end(coordinate_t low, coordinate_t high) {
+#ifdef QUADTREE_FIXED_POINT
+  return low + (high - low) / 2;
+#else
+  return (high + low) / 2;
+#endif
+}
+
+/* 
+the first co-ordinate of the upper (east or north) half of [low, high], see lower_half_end
+*/
+coordinate_t upper_half_start(coordinate_t low, coordinate_t high) {
+#ifdef QUADTREE_FIXED_POINT
+  return low + (high - low) / 2 + 1;
+#else
+  return (low + high) / 2;
+#endif
+}
+
+/* 
+the function turns the area (bottom left x, bottom left y, upper right x, upper right y) into the smallest square 
+that contains it, whose side is a power of two and whose bottom left corner is a multiple of the side. the 
+midpoints of the quadrants of such a square are exact, down to the smallest power of two of a double
+*/
+void align_square_area(double *area) {
+  double extent = (area[2] - area[0] > area[3] - area[1]) ? area[2] - area[0] : area[3] - area[1];
+  if (extent < quadtree_min_cell_size) {
+    extent = quadtree_min_cell_size;
+  }
+  int exponent;
+  frexp(extent, &exponent);
+  double side = ldexp(1, exponent);
+  double x = floor(area[0] / side) * side;
+  double y = floor(area[1] / side) * side;
+  /* the aligned corner can leave the upper right corner out of the square, a larger side always fits */
+  while (x + side < area[2] || y + side < area[3]) {
+    side *= 2;
+    x = floor(area[0] / side) * side;
+    y = floor(area[1] / side) * side;
   }
-  /* the assignment specification assumed point(s) will always be in bound, 
-  so this function will never reach -1 */
-  return -1;
+  area[0] = x;
+  area[1] = y;
+  area[2] = x + side;
+  area[3] = y + side;
+}
+
+/* 
+the point at the given longitude and latitude, see to_coordinate
+*/
+point2D_t point_at(double x, double y) {
+  point2D_t point = {to_coordinate(x, X_AXIS), to_coordinate(y, Y_AXIS)};
+  return point;
 }
 
 /*
@@ -149,6 +276,18 @@ of a rectangle
 point2D_t *create_point(double x, double y) {
   point2D_t *point = (point2D_t *)malloc(sizeof(point2D_t));
   assert(point);
+  STATS_ALLOC();
+  *point = point_at(x, y);
+  return point;
+}
+
+/*
+create a point of the quadtree (allocated with tree_alloc) from co-ordinates that are already converted (see 
+to_coordinate)
+*/
+point2D_t *new_point(coordinate_t x, coordinate_t y) {
+  point2D_t *point = (point2D_t *)tree_alloc(sizeof(point2D_t));
+  STATS_ALLOC();
   point->x = x;
   point->y = y;
   return point;
@@ -160,25 +299,70 @@ given two points; a bottom_left vertex and an upper_right vertex, create a recta
 rectangle2D_t *create_rectangle(point2D_t *bottom_left, point2D_t *upper_right) {
   rectangle2D_t *rectangle = (rectangle2D_t *)malloc(sizeof(rectangle2D_t));
   assert(rectangle);
+  STATS_ALLOC();
+  rectangle->bottom_left = bottom_left;
+  rectangle->upper_right = upper_right;
+  return rectangle;
+}
+
+/*
+create a rectangle of the quadtree (allocated with tree_alloc) from two points of the quadtree (see new_point)
+*/
+rectangle2D_t *new_rectangle(point2D_t *bottom_left, point2D_t *upper_right) {
+  rectangle2D_t *rectangle = (rectangle2D_t *)tree_alloc(sizeof(rectangle2D_t));
+  STATS_ALLOC();
   rectangle->bottom_left = bottom_left;
   rectangle->upper_right = upper_right;
   return rectangle;
 }
 
+/* 
+with -DQUADTREE_FIXED_POINT, grow the rectangle of a root into the smallest aligned cell of the fixed-point grid 
+that holds it: a square whose side is a power of two and whose corners only differ in their lowest bits. the root 
+area of the frame already is one. without fixed-point co-ordinates the rectangle is kept
+*/
+void align_cell(rectangle2D_t *rec) {
+#ifdef QUADTREE_FIXED_POINT
+  coordinate_t differ = (rec->bottom_left->x ^ rec->upper_right->x) | (rec->bottom_left->y ^ rec->upper_right->y);
+  int bits = (differ == 0) ? 0 : 32 - __builtin_clz(differ);
+  coordinate_t mask = (bits == 32) ? UINT32_MAX : (1u << bits) - 1;
+  rec->bottom_left->x &= ~mask;
+  rec->bottom_left->y &= ~mask;
+  rec->upper_right->x = rec->bottom_left->x | mask;
+  rec->upper_right->y = rec->bottom_left->y | mask;
+#endif
+}
+
+/* 
+copy the rectangle into area as longitudes and latitudes (bottom left x, bottom left y, upper right x, upper right 
+y); with -DQUADTREE_FIXED_POINT the upper right corner is the end of its unit
+*/
+void rectangle_area(rectangle2D_t *rec, double *area) {
+  area[0] = from_coordinate(rec->bottom_left->x, X_AXIS);
+  area[1] = from_coordinate(rec->bottom_left->y, Y_AXIS);
+#ifdef QUADTREE_FIXED_POINT
+  area[2] = from_coordinate(rec->upper_right->x, X_AXIS) + quadtree_unit[X_AXIS];
+  area[3] = from_coordinate(rec->upper_right->y, Y_AXIS) + quadtree_unit[Y_AXIS];
+#else
+  area[2] = rec->upper_right->x;
+  area[3] = rec->upper_right->y;
+#endif
+}
+
 /* 
 create a leaf node where its subqudrants sw, nw, ne, sw are initially NULL, with data_point inserted 
 into node->head->data_point (head is node_t*, it acts like a linked list to store data points that 
 share the same region/point)
 */
 quadtreeNode_t *create_leaf_node(dataPoint_t * data_point, rectangle2D_t *rectangle) {
-  quadtreeNode_t *node = (quadtreeNode_t *)malloc(sizeof(quadtreeNode_t));
-  assert(node);
+  quadtreeNode_t *node = (quadtreeNode_t *)tree_alloc(sizeof(quadtreeNode_t));
+  STATS_ALLOC();
   node->sw = node->nw = node->ne = node->se = NULL;
+  node->bucket = node->outside = NULL;
+  empty_summary(&node->summary);
+  empty_aggregate(&node->aggregate);
   node->rectangle = rectangle;
-  node->head = (node_t *)malloc(sizeof(node_t));
-  assert(node->head);
-  node->head->data_point = data_point;
-  node->head->next = NULL;
+  node->head = new_list_entry(data_point);
   return node;
 }
 
@@ -186,11 +370,15 @@ quadtreeNode_t *create_leaf_node(dataPoint_t * data_point, rectangle2D_t *rectan
 this function is used when an insertion operation is being performed and node A reaches a leaf node/quadrant that is
 occupied by node B. We first make the leaf node to an internal node, and push node B down to a suitable
 subquadrant using this function. We then perform node A insertion until an empty lead node/quadrant is reached.
+leaf is the leaf node being split, node B takes over its summary and aggregate
 */
-quadtreeNode_t *move_to_leaf_node(node_t *head, rectangle2D_t *rectangle) {
-  quadtreeNode_t *node = (quadtreeNode_t *)malloc(sizeof(quadtreeNode_t));
-  assert(node);
+quadtreeNode_t *move_to_leaf_node(node_t *head, quadtreeNode_t *leaf, rectangle2D_t *rectangle) {
+  quadtreeNode_t *node = (quadtreeNode_t *)tree_alloc(sizeof(quadtreeNode_t));
+  STATS_ALLOC();
   node->sw = node->nw = node->ne = node->se = NULL;
+  node->bucket = node->outside = NULL;
+  node->summary = leaf->summary;
+  node->aggregate = leaf->aggregate;
   node->rectangle = rectangle;
   node->head = head;
   return node;
@@ -203,83 +391,173 @@ rectangle2D_t *get_quadrant(rectangle2D_t *rec, int quadrant) {
   assert(quadrant >= SW && quadrant <= SE);
   point2D_t *bottom_left = NULL;
   point2D_t *upper_right = NULL;
+  coordinate_t west_end = lower_half_end(rec->bottom_left->x, rec->upper_right->x);
+  coordinate_t east_start = upper_half_start(rec->bottom_left->x, rec->upper_right->x);
+  coordinate_t south_end = lower_half_end(rec->bottom_left->y, rec->upper_right->y);
+  coordinate_t north_start = upper_half_start(rec->bottom_left->y, rec->upper_right->y);
   switch (quadrant) {
     case SW:
-      bottom_left = create_point(rec->bottom_left->x, rec->bottom_left->y);
-      upper_right = create_point((rec->upper_right->x + rec->bottom_left->x) / 2, (rec->upper_right->y + rec->bottom_left->y) / 2);
+      bottom_left = new_point(rec->bottom_left->x, rec->bottom_left->y);
+      upper_right = new_point(west_end, south_end);
       break;
     case NW:
-      bottom_left = create_point(rec->bottom_left->x, (rec->bottom_left->y + rec->upper_right->y) / 2);
-      upper_right = create_point((rec->upper_right->x + rec->bottom_left->x) / 2, rec->upper_right->y);
+      bottom_left = new_point(rec->bottom_left->x, north_start);
+      upper_right = new_point(west_end, rec->upper_right->y);
       break;
     case NE:
-      bottom_left = create_point((rec->bottom_left->x + rec->upper_right->x) / 2, (rec->bottom_left->y + rec->upper_right->y) / 2);
-      upper_right = create_point(rec->upper_right->x, rec->upper_right->y);
+      bottom_left = new_point(east_start, north_start);
+      upper_right = new_point(rec->upper_right->x, rec->upper_right->y);
       break;
     case SE:
-      bottom_left = create_point((rec->bottom_left->x + rec->upper_right->x) / 2, rec->bottom_left->y);
-      upper_right = create_point(rec->upper_right->x, (rec->upper_right->y + rec->bottom_left->y) / 2);
+      bottom_left = new_point(east_start, rec->bottom_left->y);
+      upper_right = new_point(rec->upper_right->x, south_end);
       break;
   }
   assert(bottom_left != NULL && upper_right != NULL);
-  return create_rectangle(bottom_left, upper_right);
+  return new_rectangle(bottom_left, upper_right);
 }
 
 /*
-insert a node into a quadtree 
+set the depth and cell size limits used by insert_to_quadtree; max_depth is the deepest level a leaf node can
+be split into (the root is at depth 0), min_cell_size the smallest width/height a quadrant can have
 */
-quadtreeNode_t *insert_to_quadtree(quadtreeNode_t *root, dataPoint_t *data_point, rectangle2D_t *rectangle) {
-  if (root == NULL) {
-    return create_leaf_node(data_point, rectangle);
-  }
+void set_quadtree_limits(int max_depth, double min_cell_size) {
+  assert(max_depth >= 0 && max_depth <= MAX_QUADTREE_DEPTH && min_cell_size >= 0);
+  quadtree_max_depth = max_depth;
+  quadtree_min_cell_size = min_cell_size;
+}
 
-  /* if we reach a leaf node that is full, transfer the node to an internal node by spliting it */
-  if (root->head != NULL) {
-    node_t *temp_head = root->head;
-    root->head = NULL;
-    int leaf_node_new_quadrant = determine_quadrant(root->rectangle, temp_head->data_point->location);
-    switch (leaf_node_new_quadrant) {
-      case SW:
-        root->sw = move_to_leaf_node(temp_head, get_quadrant(root->rectangle, SW));
-        break;
-      case NW:
-        root->nw = move_to_leaf_node(temp_head, get_quadrant(root->rectangle, NW));
-        break;
-      case NE:
-        root->ne = move_to_leaf_node(temp_head, get_quadrant(root->rectangle, NE));
-        break;
-      case SE:
-        root->se = move_to_leaf_node(temp_head, get_quadrant(root->rectangle, SE));
-        break;
-    }
+/*
+checks if a leaf node at the given depth can be split into four quadrants without going past the depth and cell 
+size limits. returns TRUE (1) if it can, otherwise FALSE (0) and the leaf node is used as an overflow bucket
+*/
+int can_split(rectangle2D_t *rec, int depth) {
+  if (depth >= quadtree_max_depth) {
+    return FALSE;
   }
-  /* when we are trying to insert node A and reaches a leaf node B that is full, we tend to split node B
-  and insert node B into a suitable subquadrant. We then perfrom node A insertion again with a suitable subquadrant 
-  (rectangle) pointer. But if we reach a full leaf node in the next insertion, the subquadrant (rectangle) pointer from
-  the last stage will be lost and hard to reach afterward, so we free the subquadrant pointer here */
-  if (rectangle != root->rectangle) {
-    free(rectangle->bottom_left);
-    free(rectangle->upper_right);
-    free(rectangle);
+#ifdef QUADTREE_FIXED_POINT
+  /* a cell one unit wide cannot be split */
+  if (rec->upper_right->x == rec->bottom_left->x || rec->upper_right->y == rec->bottom_left->y) {
+    return FALSE;
+  }
+  if (((rec->upper_right->x - rec->bottom_left->x) / 2 + 1) * quadtree_unit[X_AXIS] < quadtree_min_cell_size || 
+  ((rec->upper_right->y - rec->bottom_left->y) / 2 + 1) * quadtree_unit[Y_AXIS] < quadtree_min_cell_size) {
+    return FALSE;
   }
+#else
+  if ((rec->upper_right->x - rec->bottom_left->x) / 2 < quadtree_min_cell_size || 
+  (rec->upper_right->y - rec->bottom_left->y) / 2 < quadtree_min_cell_size) {
+    return FALSE;
+  }
+#endif
+  return TRUE;
+}
 
-  /* trying to insert the node until an empty quadrant/leaf node is reached */
-  int new_quadrant = determine_quadrant(root->rectangle, data_point->location);
-  switch (new_quadrant) {
+/*
+return the address of the child pointer of root in the given quadrant, so a child can be read or replaced
+*/
+quadtreeNode_t **child_slot(quadtreeNode_t *root, int quadrant) {
+  switch (quadrant) {
     case SW:
-      root->sw = insert_to_quadtree(root->sw, data_point, get_quadrant(root->rectangle, SW));
-      break;
+      return &root->sw;
     case NW:
-      root->nw = insert_to_quadtree(root->nw, data_point, get_quadrant(root->rectangle, NW));
-      break;
+      return &root->nw;
     case NE:
-      root->ne = insert_to_quadtree(root->ne, data_point, get_quadrant(root->rectangle, NE));
-      break;
+      return &root->ne;
     case SE:
-      root->se = insert_to_quadtree(root->se, data_point, get_quadrant(root->rectangle, SE));
-      break;
+      return &root->se;
+  }
+  assert(FALSE);
+  return NULL;
+}
+
+/* 
+keep a data point that lies outside the rectangle of the root in the overflow list of the root, with the data points 
+sharing its location (if any) in footpath_id order
+*/
+void insert_outside(quadtreeNode_t *root, dataPoint_t *data_point) {
+  double x, y;
+  exact_location(data_point, &x, &y);
+  for (quadtreeNode_t *leaf = root->outside; leaf != NULL; leaf = leaf->bucket) {
+    if (same_location(leaf->head->data_point, x, y)) {
+      sorted_insert_node(&leaf->head, new_list_entry(data_point));
+      return;
+    }
+  }
+  quadtreeNode_t *leaf = create_leaf_node(data_point, NULL);
+  leaf->bucket = root->outside;
+  root->outside = leaf;
+}
+
+/*
+insert a node into a quadtree, depth is the depth of root (0 for the root of the quadtree). a data point that 
+shares its location with a stored one is kept in the same linked list in footpath_id order. a leaf node that 
+cannot be split any further (see can_split) keeps every other location in its overflow bucket, and a data point 
+outside the rectangle of the root is kept in the overflow list of the root (see insert_outside). the quadtree is 
+walked down in a loop, so the insertion does not use the call stack. the summaries of the nodes are updated 
+afterwards by add_to_summaries
+*/
+quadtreeNode_t *insert_to_quadtree(quadtreeNode_t *root, dataPoint_t *data_point, rectangle2D_t *rectangle, int depth) {
+  if (root == NULL) {
+    return create_leaf_node(data_point, rectangle);
+  }
+  /* the rectangle is only needed to create a new leaf node, callers pass root->rectangle otherwise */
+  if (rectangle != root->rectangle) {
+    tree_free(rectangle->bottom_left);
+    tree_free(rectangle->upper_right);
+    tree_free(rectangle);
+  }
+
+  /* only the root can be given a data point outside its rectangle */
+  if (depth == 0 && !in_rectangle(root->rectangle, &data_point->location)) {
+    insert_outside(root, data_point);
+    return root;
+  }
+
+  /* an empty root: the data point becomes its only point */
+  if (root->head == NULL && root->sw == NULL && root->nw == NULL && root->ne == NULL && root->se == NULL) {
+    root->head = new_list_entry(data_point);
+    return root;
+  }
+
+  double x, y;
+  exact_location(data_point, &x, &y);
+  quadtreeNode_t *node = root;
+  while (TRUE) {
+    if (node->head != NULL) {
+      /* the location is already stored in this leaf node (or its overflow bucket) */
+      for (quadtreeNode_t *leaf = node; leaf != NULL; leaf = leaf->bucket) {
+        if (same_location(leaf->head->data_point, x, y)) {
+          sorted_insert_node(&leaf->head, new_list_entry(data_point));
+          return root;
+        }
+      }
+      /* the leaf node has reached the limits, chain the new location in its overflow bucket */
+      if (!can_split(node->rectangle, depth)) {
+        quadtreeNode_t *leaf = create_leaf_node(data_point, NULL);
+        leaf->bucket = node->bucket;
+        node->bucket = leaf;
+        return root;
+      }
+
+      /* if we reach a leaf node that is full, transfer the node to an internal node by spliting it */
+      node_t *temp_head = node->head;
+      node->head = NULL;
+      int leaf_node_new_quadrant = determine_quadrant(node->rectangle, &temp_head->data_point->location);
+      *child_slot(node, leaf_node_new_quadrant) = move_to_leaf_node(temp_head, node, 
+      get_quadrant(node->rectangle, leaf_node_new_quadrant));
+    }
+
+    /* trying to insert the node until an empty quadrant/leaf node is reached */
+    int new_quadrant = determine_quadrant(node->rectangle, &data_point->location);
+    quadtreeNode_t **child = child_slot(node, new_quadrant);
+    if (*child == NULL) {
+      *child = create_leaf_node(data_point, get_quadrant(node->rectangle, new_quadrant));
+      return root;
+    }
+    node = *child;
+    depth ++;
   }
-  return root;
 }
 
 /* 
@@ -300,70 +578,114 @@ int within_epsilon(double val1, double val2) {
 }
 
 /* 
-checks if two points are close to each other. the differences between their x and y should 
-be within EPSILON 
+the exact longitude and latitude of a data point of a footpath, read from the record store
 */
-int compare_point(point2D_t *p1, point2D_t *p2) {
-  if (within_epsilon(p1->x, p2->x) && within_epsilon(p1->y, p2->y)) {
-    return 0;
+void footpath_location(recordStore_t *records, dataPoint_t *data_point, double *x, double *y) {
+  uint32_t id = data_point->record_id;
+  *x = (data_point->end_point) ? records->end_lon[id] : records->start_lon[id];
+  *y = (data_point->end_point) ? records->end_lat[id] : records->start_lat[id];
+}
+
+/* 
+the exact co-ordinates of a data point: its location, or with -DQUADTREE_FIXED_POINT (where the location is rounded 
+down to the grid) the longitude and latitude of its record in quadtree_records
+*/
+void exact_location(dataPoint_t *data_point, double *x, double *y) {
+#ifdef QUADTREE_FIXED_POINT
+  footpath_location(quadtree_records, data_point, x, y);
+#else
+  *x = data_point->location.x;
+  *y = data_point->location.y;
+#endif
+}
+
+/* 
+checks if a data point is at (x, y): the differences between the exact co-ordinates (see exact_location) should 
+be within EPSILON
+*/
+int same_location(dataPoint_t *data_point, double x, double y) {
+  double data_x, data_y;
+  exact_location(data_point, &data_x, &data_y);
+  return within_epsilon(data_x, x) && within_epsilon(data_y, y);
+}
+
+/* 
+the function returns the number of data points stored in the given linked list
+*/
+int list_length(node_t *head) {
+  int length = 0;
+  while (head != NULL) {
+    length ++;
+    head = head->next;
   }
-  return 1;
+  return length;
 }
 
 /* 
-the function searches the node from the quadtree using the given point. It compares with nodes in the 
-quadtree and compare them. If they are considered the same, return the node.
+the names of the quadrants, as printed in the search paths
+*/
+char *quadrant_names[] = {STR_SW, STR_NW, STR_NE, STR_SE};
+
+/* 
+the function searches the node from the quadtree using the given point (x, y). It compares with nodes in the 
+quadtree and compare them (see same_location). If they are considered the same, return the node.
 the show_search_path parameter accepts either TRUE or FALSE, it identicates whether the search path 
-should be printed along with the searching operation
+should be printed along with the searching operation. the quadtree is walked down in a loop
 */
-node_t *search_quadtree_node_by_point(quadtreeNode_t *root, point2D_t *point, int show_search_path) {
+node_t *search_quadtree_node_by_point(quadtreeNode_t *root, double x, double y, int show_search_path) {
   assert(show_search_path == TRUE || show_search_path == FALSE);
-  if (root == NULL) {
-    return NULL;
-  }
+  point2D_t query = point_at(x, y);
+  point2D_t *point = &query;
+  node_t *result = NULL;
+  quadtreeNode_t *node = root;
+  int depth = 0;
 
-  /* check for equality when we reach every occupied leaf node */
-  if (root->head != NULL) {
-    if (compare_point(root->head->data_point->location, point) == 0) {
-      return root->head;
+  /* a point outside the rectangle of the root can only be in the overflow list of the root (if there is one), 
+  it is never searched for below the root */
+  if (root != NULL && !in_rectangle(root->rectangle, point)) {
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(0);
+    for (quadtreeNode_t *leaf = root->outside; leaf != NULL && result == NULL; leaf = leaf->bucket) {
+      STATS_INC(points_tested);
+      if (same_location(leaf->head->data_point, x, y)) {
+        STATS_ADD(points_emitted, list_length(leaf->head));
+        result = leaf->head;
+      }
     }
+    node = NULL;
   }
-    
+
   /* we keep traversing along the suitable quadrant until we reach an occupied node or
   until we reach a NULL */
-  int quadrant = determine_quadrant(root->rectangle, point);
-  switch (quadrant) {
-    case SW:
-      if (show_search_path == TRUE) {printf(" %s", STR_SW);}
-      return search_quadtree_node_by_point(root->sw, point, show_search_path);
-      break;
-    case NW:
-      if (show_search_path == TRUE) {printf(" %s", STR_NW);}
-      return search_quadtree_node_by_point(root->nw, point, show_search_path);
-      break;
-    case NE:
-      if (show_search_path == TRUE) {printf(" %s", STR_NE);}
-      return search_quadtree_node_by_point(root->ne, point, show_search_path);
-      break;
-    case SE:
-      if (show_search_path == TRUE) {printf(" %s", STR_SE);}
-      return search_quadtree_node_by_point(root->se, point, show_search_path);
-      break;
+  while (node != NULL && result == NULL) {
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(depth);
+    /* check for equality when we reach every occupied leaf node (and every location in its overflow bucket) */
+    for (quadtreeNode_t *leaf = node; node->head != NULL && leaf != NULL && result == NULL; leaf = leaf->bucket) {
+      STATS_LEAF(list_length(leaf->head));
+      STATS_INC(points_tested);
+      if (same_location(leaf->head->data_point, x, y)) {
+        STATS_ADD(points_emitted, list_length(leaf->head));
+        result = leaf->head;
+      }
+    }
+    if (result == NULL) {
+      int quadrant = determine_quadrant(node->rectangle, point);
+      if (show_search_path == TRUE) {printf(" %s", quadrant_names[quadrant]);}
+      node = get_child(node, quadrant);
+      depth ++;
+    }
   }
-  return NULL;
+  return result;
 }
 
 /*
-the function inserts data point(s) into a linked list in a sorted order
+the function inserts a list entry into a linked list in a sorted order (by the footpath_id of its data point)
 */
-void sorted_insert_data_point(node_t **head, dataPoint_t *data_point) {
-  node_t *node = (node_t *)malloc(sizeof(node_t));
-  assert(node != NULL);
-  node->data_point = data_point;
-  node->next = NULL;
-
+void sorted_insert_node(node_t **head, node_t *node) {
+  dataPoint_t *data_point = node->data_point;
   // if data_point's footpathid samller than the head's footpathid, insert it at the front
-  if (data_point->data->footpath_id < (*head)->data_point->data->footpath_id) {
+  if (data_point->footpath_id < (*head)->data_point->footpath_id) {
     node->next = *head;
     *head = node;
   } else {
@@ -375,7 +697,7 @@ void sorted_insert_data_point(node_t **head, dataPoint_t *data_point) {
         return;
       /* find the suitable position to insert the node */
       } else {
-        if (data_point->data->footpath_id >= ptr->data_point->data->footpath_id && data_point->data->footpath_id <= ptr->next->data_point->data->footpath_id) {
+        if (data_point->footpath_id >= ptr->data_point->footpath_id && data_point->footpath_id <= ptr->next->data_point->footpath_id) {
           node->next = ptr->next;
           ptr->next = node;
           return;
@@ -386,6 +708,114 @@ void sorted_insert_data_point(node_t **head, dataPoint_t *data_point) {
   }
 }
 
+/*
+the function inserts data point(s) into a linked list in a sorted order
+*/
+void sorted_insert_data_point(node_t **head, dataPoint_t *data_point) {
+  node_t *node = (node_t *)malloc(sizeof(node_t));
+  assert(node != NULL);
+  STATS_ALLOC();
+  node->data_point = data_point;
+  node->next = NULL;
+  sorted_insert_node(head, node);
+}
+
+/*
+create an entry of the linked list of a location in the quadtree (allocated with tree_alloc)
+*/
+node_t *new_list_entry(dataPoint_t *data_point) {
+  node_t *node = (node_t *)tree_alloc(sizeof(node_t));
+  STATS_ALLOC();
+  node->data_point = data_point;
+  node->next = NULL;
+  return node;
+}
+
+
+/* 
+return the child of root in the given quadrant
+*/
+quadtreeNode_t *get_child(quadtreeNode_t *root, int quadrant) {
+  return *child_slot(root, quadrant);
+}
+
+/* 
+add a data point to the aggregate of one node on its path, depth is the depth of the node and shared TRUE (1) if the 
+node also holds the start point of the footpath (only for an end point)
+*/
+void add_to_node_aggregate(quadtreeNode_t *node, int depth, int shared, dataPoint_t *data_point, 
+recordStore_t *records) {
+  if (shared) {
+    data_point->shared_depth = depth;
+  } else {
+    add_record_to_aggregate(&node->aggregate, records, data_point->record_id, 1);
+    if (data_point->end_point && data_point->shared_depth < node->aggregate.min_shared_depth) {
+      node->aggregate.min_shared_depth = data_point->shared_depth;
+    }
+  }
+}
+
+/* 
+add a data point that has just been inserted to the summaries and aggregates of the nodes on its path from node (at 
+the given depth) down to its leaf node. shared is TRUE (1) if node also holds the start point of the footpath
+*/
+void add_path_summaries(quadtreeNode_t *node, int depth, int shared, dataPoint_t *data_point, 
+recordStore_t *records) {
+  uint32_t id = data_point->record_id;
+  nodeSummary_t summary;
+  summarise_record(&summary, records, id);
+  point2D_t start = point_at(records->start_lon[id], records->start_lat[id]);
+  double x, y;
+  exact_location(data_point, &x, &y);
+  while (node != NULL) {
+    merge_summary(&node->summary, &summary);
+    add_to_node_aggregate(node, depth, shared, data_point, records);
+    if (node->head != NULL) {
+      /* the summary of the location in an overflow bucket */
+      for (quadtreeNode_t *leaf = node->bucket; leaf != NULL; leaf = leaf->bucket) {
+        if (same_location(leaf->head->data_point, x, y)) {
+          merge_summary(&leaf->summary, &summary);
+          break;
+        }
+      }
+      /* a leaf node shared by both end points is never split between them */
+      if (shared) {
+        data_point->shared_depth = SHARED_LEAF;
+      }
+      return;
+    }
+    int quadrant = determine_quadrant(node->rectangle, &data_point->location);
+    shared = shared && determine_quadrant(node->rectangle, &start) == quadrant;
+    node = get_child(node, quadrant);
+    depth ++;
+  }
+}
+
+/* 
+the function adds a data point that has just been inserted to the summaries and aggregates of the nodes on its path
+from the root. a footpath is added to the aggregate of every node that holds one of its end points once: the end 
+point only adds it to the nodes that do not hold the start point (the start point is inserted first)
+*/
+void add_to_summaries(quadtreeNode_t *root, dataPoint_t *data_point, recordStore_t *records) {
+  uint32_t id = data_point->record_id;
+  data_point->shared_depth = -1;
+  /* a data point in the overflow list of the root only adds to the summary of its location */
+  if (!in_rectangle(root->rectangle, &data_point->location)) {
+    nodeSummary_t summary;
+    summarise_record(&summary, records, id);
+    double x, y;
+    exact_location(data_point, &x, &y);
+    for (quadtreeNode_t *leaf = root->outside; leaf != NULL; leaf = leaf->bucket) {
+      if (same_location(leaf->head->data_point, x, y)) {
+        merge_summary(&leaf->summary, &summary);
+        break;
+      }
+    }
+    return;
+  }
+  point2D_t start = point_at(records->start_lon[id], records->start_lat[id]);
+  add_path_summaries(root, 0, data_point->end_point && in_rectangle(root->rectangle, &start), data_point, records);
+}
 
 /* 
 the function creates a quadtree using the data points stored in the dictionary
@@ -394,103 +824,545 @@ void make_quadtree(quadtreeNode_t *root, dict_t *dict) {
   if (dict == NULL) {
     return;
   }
-  /* instantiate the root of the quadtree, and insert the first (root) node manually */
+  /* the id ranges of the node summaries need every footpath_id */
+  set_id_ranges(dict->records);
+  quadtree_records = dict->records;
+  /* insert_to_quadtree keeps data points sharing the same location in one linked list, so a single walk
+  from the root is enough for every data point */
   node_t *ptr = dict->head;
-  root->head = (node_t *)malloc(sizeof(node_t));
-  assert(root->head);
-  root->head->data_point = ptr->data_point;
-  root->head->next = NULL;
-  ptr = ptr->next;
-
   while (ptr != NULL) {
-    /* check if the given location in the quadtree is full. If head != NULL, then there are more than one points
-    sharing the same region/location */
-    node_t *head = search_quadtree_node_by_point(root, ptr->data_point->location, FALSE);
-    /* no node with identical point/location found */
-    if (head == NULL) {
-      root = insert_to_quadtree(root, ptr->data_point, root->rectangle);
-    /* found node with identical point/location, insert the node into the linked list that is utilized to 
-    store nodes in sharing the same region */
-    } else if (head->data_point != NULL) {
-      sorted_insert_data_point(&head, ptr->data_point);
-    }
+    root = insert_to_quadtree(root, ptr->data_point, root->rectangle, 0);
+    add_to_summaries(root, ptr->data_point, dict->records);
     ptr = ptr->next;
   }
 }
 
 /* 
-the function frees the entire quadtree
+a data point of a batch inserted by insert_batch_node, with its summary: shared is TRUE (1) while the node it is 
+inserted into also holds the start point of the footpath (see add_to_summaries), quadrant is its quadrant of that 
+node
 */
-void free_quadtree(quadtreeNode_t *root) {
-  if (root == NULL) {
-    return;
+struct insertEntry {
+  dataPoint_t *data_point;
+  nodeSummary_t *summary;
+  point2D_t start;
+  int shared;
+  int quadrant;
+};
+
+/* 
+a node on the path of insert_batch_node: its data points partitioned by quadrant into scratch (start and counts), 
+the next quadrant to be passed on to its child, and the summaries of the quadrants done so far, which are merged 
+into the node and into group once every quadrant is done
+*/
+struct insertFrame {
+  quadtreeNode_t *node;
+  int depth;
+  insertEntry_t *entries;
+  insertEntry_t *scratch;
+  int start[SE + 1];
+  int counts[SE + 1];
+  int quadrant;
+  nodeSummary_t quadrants;
+  nodeSummary_t *group;
+};
+
+/* 
+the function inserts n data points that all lie in the rectangle of node (at the given depth), adds them to the 
+summaries and aggregates, and merges their summaries into group. a leaf node takes them one at a time until it is 
+split. an internal node adds every data point to its aggregate, partitions them by quadrant into scratch (keeping 
+their order) and passes each quadrant on to its child at once, so the path shared by the data points is walked 
+once instead of once per data point. the summaries of the quadrants come back merged, and are merged into the 
+node once. the nodes of the path are kept on an explicit stack
+*/
+void insert_batch_node(quadtreeNode_t *node, int depth, insertEntry_t *entries, insertEntry_t *scratch, int n, 
+recordStore_t *records, nodeSummary_t *group) {
+  insertFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  while (TRUE) {
+    while (n > 0 && node->head != NULL) {
+      insert_to_quadtree(node, entries->data_point, node->rectangle, depth);
+      add_path_summaries(node, depth, entries->shared, entries->data_point, records);
+      merge_summary(group, entries->summary);
+      entries ++;
+      scratch ++;
+      n --;
+    }
+
+    if (n > 0) {
+      assert(top < TRAVERSAL_STACK_SIZE);
+      insertFrame_t *frame = &stack[top ++];
+      *frame = (insertFrame_t){node, depth, entries, scratch, {0, 0, 0, 0}, {0, 0, 0, 0}, SW};
+      empty_summary(&frame->quadrants);
+      frame->group = group;
+      for (int i = 0; i < n; i ++) {
+        add_to_node_aggregate(node, depth, entries[i].shared, entries[i].data_point, records);
+        entries[i].quadrant = determine_quadrant(node->rectangle, &entries[i].data_point->location);
+        entries[i].shared = entries[i].shared && determine_quadrant(node->rectangle, &entries[i].start) == 
+        entries[i].quadrant;
+        frame->counts[entries[i].quadrant] ++;
+      }
+      int *counts = frame->counts, *start = frame->start;
+      start[NW] = counts[SW];
+      start[NE] = start[NW] + counts[NW];
+      start[SE] = start[NE] + counts[NE];
+      int next[SE + 1] = {start[SW], start[NW], start[NE], start[SE]};
+      for (int i = 0; i < n; i ++) {
+        scratch[next[entries[i].quadrant] ++] = entries[i];
+      }
+    }
+
+    /* pass the next quadrant of the deepest node on the path on to its child. a node whose quadrants are all done 
+    merges their summaries into itself and its group, and is taken off the path */
+    n = 0;
+    while (top > 0 && n == 0) {
+      insertFrame_t *frame = &stack[top - 1];
+      if (frame->quadrant > SE) {
+        merge_summary(&frame->node->summary, &frame->quadrants);
+        merge_summary(frame->group, &frame->quadrants);
+        top --;
+        continue;
+      }
+      int quadrant = frame->quadrant ++;
+      if (frame->counts[quadrant] == 0) {
+        continue;
+      }
+      insertEntry_t *first = frame->scratch + frame->start[quadrant];
+      int created = 0;
+      quadtreeNode_t **child = child_slot(frame->node, quadrant);
+      /* an empty quadrant: the first data point becomes its leaf node */
+      if (*child == NULL) {
+        *child = create_leaf_node(first->data_point, get_quadrant(frame->node->rectangle, quadrant));
+        add_path_summaries(*child, frame->depth + 1, first->shared, first->data_point, records);
+        merge_summary(&frame->quadrants, first->summary);
+        created = 1;
+      }
+      node = *child;
+      depth = frame->depth + 1;
+      entries = first + created;
+      scratch = frame->entries + frame->start[quadrant] + created;
+      n = frame->counts[quadrant] - created;
+      group = &frame->quadrants;
+    }
+    if (n == 0) {
+      return;
+    }
   }
+}
 
-  /* freeing a lead node (occupied node) */
-  if (root->head != NULL) {
-    node_t *ptr = NULL;
-    while (root->head != NULL) {
-      ptr = root->head;
-      root->head = root->head->next;
-      ptr->next = NULL;
-      ptr->data_point = NULL;
-      free(ptr);
+/* 
+the function inserts the data points of the list that starts at first (the rows appended to a dictionary, see 
+append_to_dictionary) into a built quadtree and its summaries, with the same result as inserting them one by one 
+(see make_quadtree). the data points within the rectangle of the root descend the quadtree together (see 
+insert_batch_node). the id ranges of the summaries are kept, the new footpath_ids are put into the ranges of the 
+quadtree as it was built. returns the number of data points inserted
+*/
+int insert_batch_to_quadtree(quadtreeNode_t *root, node_t *first, recordStore_t *records) {
+  int n = list_length(first);
+  if (n == 0) {
+    return 0;
+  }
+  insertEntry_t *entries = (insertEntry_t *)malloc(sizeof(insertEntry_t) * n);
+  insertEntry_t *scratch = (insertEntry_t *)malloc(sizeof(insertEntry_t) * n);
+  nodeSummary_t *summaries = (nodeSummary_t *)malloc(sizeof(nodeSummary_t) * n);
+  assert(entries && scratch && summaries);
+  int size = 0;
+  for (node_t *ptr = first; ptr != NULL; ptr = ptr->next) {
+    dataPoint_t *data_point = ptr->data_point;
+    int empty = root->head == NULL && root->sw == NULL && root->nw == NULL && root->ne == NULL && root->se == NULL;
+    /* the overflow list of the root, and the first data point of an empty quadtree, are inserted on their own */
+    if (empty || !in_rectangle(root->rectangle, &data_point->location)) {
+      insert_to_quadtree(root, data_point, root->rectangle, 0);
+      add_to_summaries(root, data_point, records);
+      continue;
     }
+    uint32_t id = data_point->record_id;
+    data_point->shared_depth = -1;
+    entries[size].data_point = data_point;
+    entries[size].summary = &summaries[size];
+    summarise_record(&summaries[size], records, id);
+    entries[size].start = point_at(records->start_lon[id], records->start_lat[id]);
+    entries[size].shared = data_point->end_point && in_rectangle(root->rectangle, &entries[size].start);
+    size ++;
   }
-  free(root->rectangle->bottom_left);
-  free(root->rectangle->upper_right);
-  free(root->rectangle);
-  free(root->head);
+  nodeSummary_t group;
+  empty_summary(&group);
+  insert_batch_node(root, 0, entries, scratch, size, records, &group);
+  free(entries);
+  free(scratch);
+  free(summaries);
+  return n;
+}
+
+/* 
+the function frees the entire quadtree. the nodes still to be freed are chained through their outside pointer 
+(only the root has an overflow list, and it is read before any node is chained), so the walk needs no stack 
+however deep the quadtree or long its overflow buckets are
+*/
+void free_quadtree(quadtreeNode_t *root) {
+  quadtreeNode_t *pending = NULL;
+  quadtreeNode_t *node = root;
+  while (node != NULL) {
+    quadtreeNode_t *children[] = {node->outside, node->bucket, node->sw, node->nw, node->ne, node->se};
+    for (int i = 0; i < (int)(sizeof(children) / sizeof(children[0])); i ++) {
+      if (children[i] != NULL) {
+        children[i]->outside = pending;
+        pending = children[i];
+      }
+    }
 
-  free_quadtree(root->sw);
-  free_quadtree(root->nw);
-  free_quadtree(root->ne);
-  free_quadtree(root->se);
+    /* freeing a lead node (occupied node) */
+    while (node->head != NULL) {
+      node_t *ptr = node->head;
+      node->head = node->head->next;
+      tree_free(ptr);
+    }
+    /* the locations chained in an overflow bucket share the rectangle of the leaf node. the rectangle of the root 
+    is the one given to create_empty_quadtree, the others come from tree_alloc */
+    if (node == root) {
+      free(node->rectangle->bottom_left);
+      free(node->rectangle->upper_right);
+      free(node->rectangle);
+    } else if (node->rectangle != NULL) {
+      tree_free(node->rectangle->bottom_left);
+      tree_free(node->rectangle->upper_right);
+      tree_free(node->rectangle);
+    }
+    tree_free(node);
 
-  free(root);
+    node = pending;
+    if (node != NULL) {
+      pending = node->outside;
+      node->outside = NULL;
+    }
+  }
+}
+
+/* 
+returns TRUE (1) if a data point under the given node may match the filter, always TRUE when there is no filter
+*/
+int subtree_may_match(quadtreeNode_t *node, attributeFilter_t *filter) {
+  if (filter == NULL || filter_may_match(filter, &node->summary)) {
+    return TRUE;
+  }
+  STATS_INC(subtrees_pruned);
+  return FALSE;
+}
+
+/* 
+a node a range cursor still has to visit, with its depth and the quadrant it lies in (printed in the search path), 
+or ROOT_FRAME for the root and OUTSIDE_FRAME for the overflow list of the root
+*/
+struct rangeFrame {
+  quadtreeNode_t *node;
+  int depth;
+  int quadrant;
+};
+
+/* 
+the state of a range query that is read a batch of data points at a time (see next_range_batch)
+*/
+struct rangeCursor {
+  rectangle2D_t *range_rectangle;
+  attributeFilter_t *filter;
+  int show_search_path;
+  /* the location to be tested next (of a leaf node, its overflow bucket or the overflow list of the root), the 
+  following ones are chained through bucket */
+  quadtreeNode_t *location;
+  /* the next data point of the current location, once the location is known to lie within the range rectangle */
+  node_t *entry;
+  /* the nodes still to be visited, the one on top is visited next */
+  rangeFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top;
+};
+
+/* 
+start a range query: the returned cursor gives the data points within the range rectangle that match the filter 
+(NULL for none) in the order of the search (see next_range_batch). it has to be closed with close_range_cursor. the 
+search path is printed to stdout while the quadtree is walked if show_search_path is TRUE
+*/
+rangeCursor_t *open_range_cursor(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, 
+int show_search_path) {
+  rangeCursor_t *cursor = (rangeCursor_t *)malloc(sizeof(rangeCursor_t));
+  assert(cursor);
+  STATS_ALLOC();
+  cursor->range_rectangle = range_rectangle;
+  cursor->filter = filter;
+  cursor->show_search_path = show_search_path;
+  cursor->location = NULL;
+  cursor->entry = NULL;
+  cursor->top = 0;
+  cursor->stack[cursor->top ++] = (rangeFrame_t){root, 0, ROOT_FRAME};
+  /* the overflow list of the root is searched first, it is not part of the search path */
+  if (root->outside != NULL) {
+    cursor->stack[cursor->top ++] = (rangeFrame_t){root, 0, OUTSIDE_FRAME};
+  }
+  return cursor;
+}
+
+/* 
+write the next (at most size) data points of the range query to batch and return their number, 0 once the query 
+is done. the quadtree is walked depth-first with the explicit stack of the cursor, in the same order as a recursive 
+search (SW, NW, NE, SE), so a caller can consume the results incrementally. a footpath with both end points within 
+the range rectangle is given twice
+*/
+int next_range_batch(rangeCursor_t *cursor, dataPoint_t **batch, int size) {
+  attributeFilter_t *filter = cursor->filter;
+  int n = 0;
+  while (n < size) {
+    /* the data points of the current location */
+    if (cursor->entry != NULL) {
+      dataPoint_t *data_point = cursor->entry->data_point;
+      cursor->entry = cursor->entry->next;
+      if (filter == NULL || filter_matches_record(filter, data_point->record_id)) {
+        STATS_INC(points_emitted);
+        batch[n ++] = data_point;
+      }
+      continue;
+    }
+
+    /* every location is tested on its own */
+    if (cursor->location != NULL) {
+      quadtreeNode_t *leaf = cursor->location;
+      cursor->location = leaf->bucket;
+      STATS_LEAF(list_length(leaf->head));
+      STATS_INC(points_tested);
+      if (!in_rectangle(cursor->range_rectangle, &leaf->head->data_point->location)) {
+        continue;
+      }
+      if (filter != NULL && !filter_may_match(filter, &leaf->summary)) {
+        STATS_INC(subtrees_pruned);
+        continue;
+      }
+      cursor->entry = leaf->head;
+      continue;
+    }
+
+    if (cursor->top == 0) {
+      break;
+    }
+    rangeFrame_t frame = cursor->stack[-- cursor->top];
+    quadtreeNode_t *node = frame.node;
+    if (frame.quadrant == OUTSIDE_FRAME) {
+      STATS_DEPTH(0);
+      cursor->location = node->outside;
+      continue;
+    }
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(frame.depth);
+    if (cursor->show_search_path && frame.quadrant != ROOT_FRAME) {
+      printf(" %s", quadrant_names[frame.quadrant]);
+    }
+    if (node->head != NULL) {
+      if (rectangle_overlap(node->rectangle, cursor->range_rectangle)) {
+        cursor->location = node;
+      }
+      continue;
+    }
+
+    /* the rectangles of the four children (and then their corners) are fetched together, so their misses overlap 
+    instead of following each other */
+    for (int quadrant = SW; quadrant <= SE; quadrant ++) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child) {
+        PREFETCH(child->rectangle);
+      }
+    }
+    for (int quadrant = SW; quadrant <= SE; quadrant ++) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child) {
+        PREFETCH(child->rectangle->bottom_left);
+        PREFETCH(child->rectangle->upper_right);
+      }
+    }
+
+    /* the suitable subquadrants are pushed in reverse, so they are searched in the order SW, NW, NE, SE */
+    assert(cursor->top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && rectangle_overlap(child->rectangle, cursor->range_rectangle) && subtree_may_match(child, filter)) {
+        cursor->stack[cursor->top ++] = (rangeFrame_t){child, frame.depth + 1, quadrant};
+        /* what a node points to is only read once it is popped, so it is fetched while the nodes above it on the 
+        stack are searched */
+        PREFETCH(child->head);
+        PREFETCH(child->sw);
+        PREFETCH(child->nw);
+        PREFETCH(child->ne);
+        PREFETCH(child->se);
+      }
+    }
+  }
+  return n;
+}
+
+/* 
+free a range cursor, the query does not have to be done
+*/
+void close_range_cursor(rangeCursor_t *cursor) {
+  free(cursor);
 }
 
 /* 
 the function receives a node_t **head (linked list) and a rectangle (range query), and ascendingly store all the nodes that 
-lies within the region into the head (linked list)
+lies within the region into the head (linked list). filter is the attribute predicate the records have to match, or 
+NULL for none; subtrees whose summary cannot match the filter are not searched (and not printed in the search path).
+the data points are taken from a range cursor, RANGE_BATCH_SIZE at a time
 */
-void range_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, node_t **head) {
-  if (rectangle_overlap(root->rectangle, range_rectangle) && root->head != NULL && in_rectangle(range_rectangle, root->head->data_point->location)) {
-    node_t *ptr = root->head;
-    
-    while (ptr != NULL) {
+void range_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, node_t **head) {
+  dataPoint_t *batch[RANGE_BATCH_SIZE];
+  rangeCursor_t *cursor = open_range_cursor(root, range_rectangle, filter, TRUE);
+  int n;
+  while ((n = next_range_batch(cursor, batch, RANGE_BATCH_SIZE)) > 0) {
+    for (int i = 0; i < n; i ++) {
       /* if the data_point is NULL in head */
       if ((*head)->data_point == NULL) {
-        (*head)->data_point = ptr->data_point;
+        (*head)->data_point = batch[i];
         (*head)->next = NULL;
       } else {
-        sorted_insert_data_point(head, ptr->data_point);
+        sorted_insert_data_point(head, batch[i]);
       }
-      ptr = ptr->next;
     }
-    return;
   }
+  close_range_cursor(cursor);
+}
 
-  /* recursively search in the suitable subquardrants */
-  if (root->sw && rectangle_overlap(root->sw->rectangle, range_rectangle)) {
-    printf(" %s", STR_SW);
-    range_query(root->sw, range_rectangle, head);
+/* 
+tests whether the inner rectangle lies entirely within the outer rectangle and returns TRUE (1) if it does
+*/
+int rectangle_contains(rectangle2D_t *outer, rectangle2D_t *inner) {
+  return in_rectangle(outer, inner->bottom_left) && in_rectangle(outer, inner->upper_right);
+}
+
+/* 
+returns TRUE (1) if the start point of the footpath with the given record id lies within the rectangle. every start 
+point is stored (in the quadtree or its overflow list), so a footpath found at its end point is also found at its 
+start point when this holds
+*/
+int start_in_rectangle(rectangle2D_t *rec, recordStore_t *records, uint32_t id) {
+  point2D_t start = point_at(records->start_lon[id], records->start_lat[id]);
+  return in_rectangle(rec, &start);
+}
+
+/* 
+returns TRUE (1) if the start point of the footpath with the given record id lies within the query rectangle, so the 
+footpath is counted at its start point
+*/
+int start_in_query(aggregateQuery_t *query, uint32_t id) {
+  return start_in_rectangle(query->range, query->records, id);
+}
+
+/* 
+the function removes from the query result the footpaths that an aggregate taken from a node at the given depth 
+counted at their end point while their start point (outside the node) is also within the query rectangle; only 
+the subtrees with such end points (min_shared_depth < depth) are searched
+*/
+void subtract_straddling(quadtreeNode_t *root, int depth, aggregateQuery_t *query) {
+  rangeFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (rangeFrame_t){root, depth, ROOT_FRAME};
+  while (top > 0) {
+    rangeFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(frame.depth);
+    if (node->head != NULL) {
+      for (quadtreeNode_t *leaf = node; leaf != NULL; leaf = leaf->bucket) {
+        STATS_LEAF(list_length(leaf->head));
+        for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+          STATS_INC(points_tested);
+          dataPoint_t *data_point = ptr->data_point;
+          if (data_point->end_point && data_point->shared_depth < depth && start_in_query(query, data_point->record_id)) {
+            add_record_to_aggregate(&query->result, query->records, data_point->record_id, -1);
+          }
+        }
+      }
+      continue;
+    }
+    /* the children are pushed in reverse, so they are searched in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && child->aggregate.min_shared_depth < depth) {
+        stack[top ++] = (rangeFrame_t){child, frame.depth + 1, quadrant};
+      }
+    }
   }
+}
 
-  if (root->nw && rectangle_overlap(root->nw->rectangle, range_rectangle)) {
-    printf(" %s", STR_NW);
-    range_query(root->nw, range_rectangle, head);
+/* 
+the function adds the footpaths of a leaf node and its overflow bucket (or of the overflow list of the root) that are
+counted at one of its locations within the query rectangle to query->result
+*/
+void aggregate_locations(quadtreeNode_t *leaf, aggregateQuery_t *query) {
+  for (; leaf != NULL; leaf = leaf->bucket) {
+    STATS_LEAF(list_length(leaf->head));
+    STATS_INC(points_tested);
+    if (!in_rectangle(query->range, &leaf->head->data_point->location)) {
+      continue;
+    }
+    for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+      dataPoint_t *data_point = ptr->data_point;
+      if (query->filter != NULL && !filter_matches_record(query->filter, data_point->record_id)) {
+        continue;
+      }
+      if (!data_point->end_point || !start_in_query(query, data_point->record_id)) {
+        STATS_INC(points_emitted);
+        add_record_to_aggregate(&query->result, query->records, data_point->record_id, 1);
+      }
+    }
   }
+}
 
-  if (root->ne && rectangle_overlap(root->ne->rectangle, range_rectangle)) {
-    printf(" %s", STR_NE);
-    range_query(root->ne, range_rectangle, head);
+/* 
+the function adds the footpaths within the query rectangle (the same footpaths as range_query) to query->result 
+without collecting them, depth is the depth of root. a node that lies entirely within the query rectangle adds 
+its aggregate; every footpath is counted once, at its start point if that is within the query rectangle, 
+otherwise at its end point. with an attribute filter, the records are tested one by one instead
+*/
+void aggregate_query(quadtreeNode_t *root, int depth, aggregateQuery_t *query) {
+  rangeFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (rangeFrame_t){root, depth, ROOT_FRAME};
+  while (top > 0) {
+    rangeFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(frame.depth);
+    if (query->filter == NULL && node->rectangle != NULL && rectangle_contains(query->range, node->rectangle)) {
+      add_aggregate(&query->result, &node->aggregate);
+      if (node->aggregate.min_shared_depth < frame.depth) {
+        subtract_straddling(node, frame.depth, query);
+      }
+      continue;
+    }
+
+    if (node->head != NULL) {
+      if (rectangle_overlap(node->rectangle, query->range)) {
+        aggregate_locations(node, query);
+      }
+      continue;
+    }
+
+    /* the children are pushed in reverse, so they are added in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && rectangle_overlap(child->rectangle, query->range) && subtree_may_match(child, query->filter)) {
+        stack[top ++] = (rangeFrame_t){child, frame.depth + 1, quadrant};
+      }
+    }
   }
+}
 
-  if (root->se && rectangle_overlap(root->se->rectangle, range_rectangle)) {
-    printf(" %s", STR_SE);
-    range_query(root->se, range_rectangle, head);
-  }  
+/* 
+the function answers an aggregate query over the whole quadtree: query->result is set to the count, sums and 
+grade1in histogram of the footpaths within query->range that match query->filter (if any), including the ones in 
+the overflow list of the root
+*/
+void aggregate_quadtree(quadtreeNode_t *root, aggregateQuery_t *query) {
+  empty_aggregate(&query->result);
+  aggregate_query(root, 0, query);
+  aggregate_locations(root->outside, query);
 }
 
 /* 
@@ -501,7 +1373,7 @@ may contain a number of duplicates, so we remove duplicates using this function
 void remove_duplicate(node_t *head) {
   node_t *ptr = head;
   while (ptr != NULL && ptr->next != NULL) {
-    if (ptr->data_point->data->footpath_id == ptr->next->data_point->data->footpath_id) {
+    if (ptr->data_point->footpath_id == ptr->next->data_point->footpath_id) {
       node_t *delete_node = ptr->next;
       ptr->next = delete_node->next;
       free(delete_node);
@@ -511,3 +1383,309 @@ void remove_duplicate(node_t *head) {
   }
 }
 
+/* 
+the function walks the quadtree and accumulates its shape and memory footprint into stats, depth is the
+depth of the given node (0 for the root), with an explicit stack. stats is expected to be zeroed by the caller, the 
+records are accounted for by the record store (record_store_bytes)
+*/
+void collect_quadtree_stats(quadtreeNode_t *root, int depth, treeStats_t *stats) {
+  if (root == NULL) {
+    return;
+  }
+  rangeFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (rangeFrame_t){root, depth, ROOT_FRAME};
+  while (top > 0) {
+    rangeFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    stats->node_bytes += sizeof(quadtreeNode_t);
+    stats->rectangle_bytes += sizeof(rectangle2D_t) + 2 * sizeof(point2D_t);
+    if (frame.depth == 0) {
+      rectangle_area(node->rectangle, stats->root_area);
+    }
+    /* the overflow list of the root */
+    for (quadtreeNode_t *leaf = node->outside; leaf != NULL; leaf = leaf->bucket) {
+      stats->outside_locations ++;
+      stats->node_bytes += sizeof(quadtreeNode_t);
+      for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+        stats->outside_points ++;
+        stats->list_bytes += sizeof(node_t);
+        stats->data_point_bytes += sizeof(dataPoint_t);
+      }
+    }
+    if (frame.depth > stats->max_depth) {
+      stats->max_depth = frame.depth;
+    }
+
+    /* occupied leaf node: account for the linked list(s) and the data points they refer to */
+    if (node->head != NULL) {
+      if (node->bucket != NULL) {
+        stats->bucket_leaves ++;
+      }
+      for (quadtreeNode_t *leaf = node; leaf != NULL; leaf = leaf->bucket) {
+        int length = 0;
+        for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+          length ++;
+          stats->list_bytes += sizeof(node_t);
+          stats->data_point_bytes += sizeof(dataPoint_t);
+        }
+        if (leaf != node) {
+          stats->bucket_locations ++;
+          stats->node_bytes += sizeof(quadtreeNode_t);
+        }
+        stats->list_entries += length;
+        if (length > stats->max_list_length) {
+          stats->max_list_length = length;
+        }
+      }
+      stats->leaf_nodes ++;
+      stats->depth_histogram[(frame.depth < STATS_MAX_DEPTH) ? frame.depth : STATS_MAX_DEPTH] ++;
+      continue;
+    }
+
+    /* internal node: NULL children are the empty (white) leaves */
+    if (node->sw == NULL && node->nw == NULL && node->ne == NULL && node->se == NULL) {
+      /* an empty root is a single empty leaf */
+      stats->empty_leaves ++;
+      continue;
+    }
+    stats->internal_nodes ++;
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child == NULL) {
+        stats->empty_leaves ++;
+      } else {
+        stack[top ++] = (rangeFrame_t){child, frame.depth + 1, quadrant};
+      }
+    }
+  }
+}
+
+/* 
+a query of batch_search_quadtree: its Morton (Z-order) code, its position in the input and its co-ordinates (the 
+exact ones, x and y, and the point of the quadtree they are routed by)
+*/
+struct batchQuery {
+  uint64_t code;
+  int index;
+  int quadrant;
+  point2D_t point;
+  double x;
+  double y;
+};
+
+/* 
+spread the 32 bits of value to the even bits of a 64-bit integer
+*/
+uint64_t spread_bits(uint32_t value) {
+  uint64_t x = value;
+  x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+  x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+  x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x << 2)) & 0x3333333333333333ULL;
+  x = (x | (x << 1)) & 0x5555555555555555ULL;
+  return x;
+}
+
+/* 
+the function returns the Morton (Z-order) code of a point relative to the given rectangle: x and y are scaled to 
+32-bit integers and their bits interleaved, so points that are close in the quadtree are close in the code order. 
+points outside the rectangle are clamped onto it
+*/
+uint64_t morton_code(rectangle2D_t *rec, point2D_t *point) {
+#ifdef QUADTREE_FIXED_POINT
+  /* the cells of the quadtree are aligned on the fixed-point grid, the co-ordinates already are in Z-order */
+  return (spread_bits(point->y) << 1) | spread_bits(point->x);
+#else
+  double width = rec->upper_right->x - rec->bottom_left->x;
+  double height = rec->upper_right->y - rec->bottom_left->y;
+  double scaled_x = (width > 0) ? (point->x - rec->bottom_left->x) / width * 4294967296.0 : 0;
+  double scaled_y = (height > 0) ? (point->y - rec->bottom_left->y) / height * 4294967296.0 : 0;
+  uint32_t x = (scaled_x <= 0) ? 0 : (scaled_x >= 4294967295.0) ? UINT32_MAX : (uint32_t)scaled_x;
+  uint32_t y = (scaled_y <= 0) ? 0 : (scaled_y >= 4294967295.0) ? UINT32_MAX : (uint32_t)scaled_y;
+  return (spread_bits(y) << 1) | spread_bits(x);
+#endif
+}
+
+/* 
+the function sorts n batch queries by Morton code with a stable least-significant-digit radix sort (four 
+16-bit digits), using scratch as the buffer of the odd passes. queries with the same code keep their input order
+*/
+void sort_batch_queries(batchQuery_t *queries, batchQuery_t *scratch, int n) {
+  int *counts = (int *)malloc(sizeof(int) * (RADIX_BUCKETS + 1));
+  assert(counts);
+  STATS_ALLOC();
+  batchQuery_t *from = queries;
+  batchQuery_t *to = scratch;
+  for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+    memset(counts, 0, sizeof(int) * (RADIX_BUCKETS + 1));
+    for (int i = 0; i < n; i ++) {
+      counts[((from[i].code >> shift) & (RADIX_BUCKETS - 1)) + 1] ++;
+    }
+    for (int digit = 0; digit < RADIX_BUCKETS; digit ++) {
+      counts[digit + 1] += counts[digit];
+    }
+    for (int i = 0; i < n; i ++) {
+      to[counts[(from[i].code >> shift) & (RADIX_BUCKETS - 1)] ++] = from[i];
+    }
+    batchQuery_t *temp = from;
+    from = to;
+    to = temp;
+  }
+  /* an even number of passes, the sorted queries are back in queries */
+  assert(from == queries);
+  free(counts);
+}
+
+/* 
+a group of batch queries that all lie in the quadrant of node, with the scratch space of the same positions 
+*/
+struct batchFrame {
+  quadtreeNode_t *node;
+  batchQuery_t *queries;
+  batchQuery_t *scratch;
+  int n;
+};
+
+/* 
+the function resolves n queries that all lie in root's quadrant at once: the midpoint of every node on their 
+shared path is computed and the node is loaded once for all of them. queries that are not already grouped by
+quadrant are split into scratch (same positions), which then becomes the query array of the next level. the groups 
+still to be resolved are kept on an explicit stack
+*/
+void batch_search_node(quadtreeNode_t *root, batchQuery_t *queries, batchQuery_t *scratch, int n, node_t **results) {
+  if (root == NULL || n == 0) {
+    return;
+  }
+  batchFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (batchFrame_t){root, queries, scratch, n};
+  while (top > 0) {
+    batchFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    queries = frame.queries;
+    scratch = frame.scratch;
+    n = frame.n;
+    STATS_ADD(nodes_visited, 1);
+
+    /* occupied leaf node: compare every query with each location stored in the leaf node */
+    if (node->head != NULL) {
+      for (int i = 0; i < n; i ++) {
+        for (quadtreeNode_t *leaf = node; leaf != NULL; leaf = leaf->bucket) {
+          STATS_INC(points_tested);
+          if (same_location(leaf->head->data_point, queries[i].x, queries[i].y)) {
+            results[queries[i].index] = leaf->head;
+            break;
+          }
+        }
+      }
+      continue;
+    }
+
+    /* the children are fetched while the queries are partitioned, so the misses of the subtrees the queries go on 
+    to overlap with each other and with the partition */
+    PREFETCH(node->sw);
+    PREFETCH(node->nw);
+    PREFETCH(node->ne);
+    PREFETCH(node->se);
+
+    /* partition the queries by quadrant, keeping the Z-order within each quadrant. the bounds and midpoint are 
+    loaded once for every query (same rule as get_quadrant) */
+    coordinate_t left_bound = node->rectangle->bottom_left->x;
+    coordinate_t bot_bound = node->rectangle->bottom_left->y;
+    coordinate_t right_bound = node->rectangle->upper_right->x;
+    coordinate_t up_bound = node->rectangle->upper_right->y;
+    coordinate_t west_end = lower_half_end(left_bound, right_bound);
+    coordinate_t south_end = lower_half_end(bot_bound, up_bound);
+    coordinate_t north_start = upper_half_start(bot_bound, up_bound);
+    int counts[SE + 1] = {0, 0, 0, 0};
+    /* in Z-order the quadrants come as SW, SE, NW, NE; while the queries follow that order they are already
+    grouped by quadrant and are not copied */
+    int z_rank[SE + 1] = {0, 2, 3, 1};
+    int in_z_order = TRUE;
+    int last_rank = 0;
+    for (int i = 0; i < n; i ++) {
+      coordinate_t x = queries[i].point.x;
+      coordinate_t y = queries[i].point.y;
+      if (x < left_bound || x > right_bound || y < bot_bound || y > up_bound) {
+        queries[i].quadrant = -1;
+        in_z_order = FALSE;
+        continue;
+      }
+      if (x <= west_end) {
+        queries[i].quadrant = (y <= south_end) ? SW : NW;
+      } else {
+        queries[i].quadrant = (y >= north_start) ? NE : SE;
+      }
+      counts[queries[i].quadrant] ++;
+      if (z_rank[queries[i].quadrant] < last_rank) {
+        in_z_order = FALSE;
+      }
+      last_rank = z_rank[queries[i].quadrant];
+    }
+    int start[SE + 1];
+    start[SW] = 0;
+    start[SE] = counts[SW];
+    start[NW] = start[SE] + counts[SE];
+    start[NE] = start[NW] + counts[NW];
+
+    /* otherwise (points on a quadrant boundary, or out of bound) split them into scratch, which becomes the query 
+    array of the children */
+    if (!in_z_order) {
+      int next[SE + 1] = {start[SW], start[NW], start[NE], start[SE]};
+      for (int i = 0; i < n; i ++) {
+        if (queries[i].quadrant >= SW) {
+          scratch[next[queries[i].quadrant] ++] = queries[i];
+        }
+      }
+      batchQuery_t *swap = queries;
+      queries = scratch;
+      scratch = swap;
+    }
+
+    /* the groups are pushed in reverse, so they are resolved in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && counts[quadrant] > 0) {
+        stack[top ++] = (batchFrame_t){child, queries + start[quadrant], scratch + start[quadrant], counts[quadrant]};
+      }
+    }
+  }
+}
+
+/* 
+the function looks up n points at once, given as x, y pairs (points[2 * i], points[2 * i + 1]). the points are 
+sorted into Z-order and descend the quadtree together, so the shared prefix of their search paths is walked once. 
+results[i] is set to the head of the linked list stored at point i (as search_quadtree_node_by_point would 
+return), or NULL if there is none
+*/
+void batch_search_quadtree(quadtreeNode_t *root, double *points, int n, node_t **results) {
+  if (n <= 0) {
+    return;
+  }
+  batchQuery_t *queries = (batchQuery_t *)malloc(sizeof(batchQuery_t) * n);
+  batchQuery_t *scratch = (batchQuery_t *)malloc(sizeof(batchQuery_t) * n);
+  assert(queries && scratch);
+  STATS_ADD(allocations, 2);
+  for (int i = 0; i < n; i ++) {
+    queries[i].x = points[2 * i];
+    queries[i].y = points[2 * i + 1];
+    queries[i].point = point_at(queries[i].x, queries[i].y);
+    queries[i].code = morton_code(root->rectangle, &queries[i].point);
+    queries[i].index = i;
+    results[i] = NULL;
+  }
+  sort_batch_queries(queries, scratch, n);
+  batch_search_node(root, queries, scratch, n, results);
+  /* the points outside the rectangle of the root are looked up in its overflow list */
+  for (int i = 0; root->outside != NULL && i < n; i ++) {
+    point2D_t point = point_at(points[2 * i], points[2 * i + 1]);
+    if (!in_rectangle(root->rectangle, &point)) {
+      results[i] = search_quadtree_node_by_point(root, points[2 * i], points[2 * i + 1], FALSE);
+    }
+  }
+  free(queries);
+  free(scratch);
+}
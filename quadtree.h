@@ -1,6 +1,9 @@
 #ifndef _QUADTREE_H_
 #define _QUADTREE_H_
 
+#include <stdio.h>
+#include <stdint.h>
+
 #define SW 0
 #define STR_SW "SW"
 #define NW 1
@@ -12,35 +15,137 @@
 #define FALSE 0
 #define TRUE 1
 #define EPSILON 10e-13
+/* default limits of insert_to_quadtree, below them leaf nodes become overflow buckets */
+#define DEFAULT_MAX_DEPTH 40
+#define DEFAULT_MIN_CELL_SIZE EPSILON
+/* deepest level a leaf node can be split into (--max-depth is capped at it), which bounds the explicit stacks of 
+the iterative traversals: a depth-first walk keeps at most three siblings per level, plus the children of a node */
+#define MAX_QUADTREE_DEPTH 64
+#define TRAVERSAL_STACK_SIZE (3 * MAX_QUADTREE_DEPTH + 4)
+/* number of data points range_query takes from its cursor at a time */
+#define RANGE_BATCH_SIZE 64
+/* software prefetch of a block that a traversal reads soon (a node, a list entry), so its cache miss overlaps with 
+the work done until then. build with -DQUADTREE_NO_PREFETCH to leave the prefetches out */
+#ifdef QUADTREE_NO_PREFETCH
+#define PREFETCH(address) ((void)0)
+#else
+#define PREFETCH(address) __builtin_prefetch(address)
+#endif
+/* quadrant of the stack frames of a range cursor that are not a child of their parent */
+#define ROOT_FRAME -1
+#define OUTSIDE_FRAME -2
+/* digit size of the radix sort of batch queries by Morton code */
+#define RADIX_BITS 16
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+/* fixed-point co-ordinates (build with -DQUADTREE_FIXED_POINT): the root area is mapped onto the cell 
+[FIXED_ROOT, 2 * FIXED_ROOT - 1] of both axes, which leaves room for a root width below and two above it */
+#define FIXED_ROOT (1u << 30)
+#define X_AXIS 0
+#define Y_AXIS 1
+
+/* the co-ordinates of a point2D_t */
+#ifdef QUADTREE_FIXED_POINT
+typedef uint32_t coordinate_t;
+#else
+typedef double coordinate_t;
+#endif
 
 typedef struct point2D point2D_t;
 typedef struct rectangle2D rectangle2D_t;
 typedef struct dataPoint dataPoint_t;
 typedef struct node node_t;
-typedef struct data data_t;
+typedef struct recordStore recordStore_t;
 typedef struct list list_t;
 typedef list_t dict_t;
 typedef struct quadtreeNode quadtreeNode_t;
+typedef struct treeStats treeStats_t;
+typedef struct batchQuery batchQuery_t;
+typedef struct batchFrame batchFrame_t;
+typedef struct nodeSummary nodeSummary_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct aggregateQuery aggregateQuery_t;
+typedef struct rangeFrame rangeFrame_t;
+typedef struct rangeCursor rangeCursor_t;
+typedef struct insertEntry insertEntry_t;
+typedef struct insertFrame insertFrame_t;
+
+/* a location of the quadtree, held by value in every data point */
+struct point2D {
+  coordinate_t x;
+  coordinate_t y;
+};
 
+/* the width and height of one fixed-point unit (set_quadtree_frame), and the records the exact co-ordinates of 
+the data points are read from (make_quadtree) */
+extern double quadtree_unit[2];
+extern recordStore_t *quadtree_records;
+
+void set_quadtree_frame(double *area);
+coordinate_t to_coordinate(double value, int axis);
+double from_coordinate(coordinate_t value, int axis);
 int in_rectangle(rectangle2D_t *rec, point2D_t *point);
 quadtreeNode_t *create_empty_quadtree(rectangle2D_t *node_area);
 int rectangle_overlap(rectangle2D_t *rec1, rectangle2D_t *rec2);
-int in_quadrant(rectangle2D_t *rec, point2D_t *point, int quadrant_code);
+coordinate_t lower_half_end(coordinate_t low, coordinate_t high);
+coordinate_t upper_half_start(coordinate_t low, coordinate_t high);
 int determine_quadrant(rectangle2D_t *rec, point2D_t *point);
+void align_square_area(double *area);
+point2D_t point_at(double x, double y);
 point2D_t *create_point(double x, double y);
+point2D_t *new_point(coordinate_t x, coordinate_t y);
 rectangle2D_t *create_rectangle(point2D_t *bottom_left, point2D_t *upper_right);
+rectangle2D_t *new_rectangle(point2D_t *bottom_left, point2D_t *upper_right);
+void align_cell(rectangle2D_t *rec);
+void rectangle_area(rectangle2D_t *rec, double *area);
 quadtreeNode_t *create_leaf_node(dataPoint_t * data_point, rectangle2D_t *rectangle);
-quadtreeNode_t *move_to_leaf_node(node_t *head, rectangle2D_t *rectangle);
+quadtreeNode_t *move_to_leaf_node(node_t *head, quadtreeNode_t *leaf, rectangle2D_t *rectangle);
 rectangle2D_t *get_quadrant(rectangle2D_t *rec, int quadrant);
-quadtreeNode_t *insert_to_quadtree(quadtreeNode_t *root, dataPoint_t *data_point, rectangle2D_t *rectangle);
+void set_quadtree_limits(int max_depth, double min_cell_size);
+int can_split(rectangle2D_t *rec, int depth);
+quadtreeNode_t **child_slot(quadtreeNode_t *root, int quadrant);
+void insert_outside(quadtreeNode_t *root, dataPoint_t *data_point);
+quadtreeNode_t *insert_to_quadtree(quadtreeNode_t *root, dataPoint_t *data_point, rectangle2D_t *rectangle, int depth);
 double lfabs(double value);
 int within_epsilon(double val1, double val2);
-int compare_point(point2D_t *p1, point2D_t *p2);
-node_t *search_quadtree_node_by_point(quadtreeNode_t *root, point2D_t *point, int show_search_path);
+void footpath_location(recordStore_t *records, dataPoint_t *data_point, double *x, double *y);
+void exact_location(dataPoint_t *data_point, double *x, double *y);
+int same_location(dataPoint_t *data_point, double x, double y);
+node_t *search_quadtree_node_by_point(quadtreeNode_t *root, double x, double y, int show_search_path);
+void sorted_insert_node(node_t **head, node_t *node);
 void sorted_insert_data_point(node_t **head, dataPoint_t *data_point);
+node_t *new_list_entry(dataPoint_t *data_point);
+quadtreeNode_t *get_child(quadtreeNode_t *root, int quadrant);
+void add_to_node_aggregate(quadtreeNode_t *node, int depth, int shared, dataPoint_t *data_point, 
+recordStore_t *records);
+void add_path_summaries(quadtreeNode_t *node, int depth, int shared, dataPoint_t *data_point, 
+recordStore_t *records);
+void add_to_summaries(quadtreeNode_t *root, dataPoint_t *data_point, recordStore_t *records);
 void make_quadtree(quadtreeNode_t *root, dict_t *dict);
-void range_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, node_t **head);
+void insert_batch_node(quadtreeNode_t *node, int depth, insertEntry_t *entries, insertEntry_t *scratch, int n, 
+recordStore_t *records, nodeSummary_t *group);
+int insert_batch_to_quadtree(quadtreeNode_t *root, node_t *first, recordStore_t *records);
+int subtree_may_match(quadtreeNode_t *node, attributeFilter_t *filter);
+rangeCursor_t *open_range_cursor(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, 
+int show_search_path);
+int next_range_batch(rangeCursor_t *cursor, dataPoint_t **batch, int size);
+void close_range_cursor(rangeCursor_t *cursor);
+void range_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, attributeFilter_t *filter, node_t **head);
+int rectangle_contains(rectangle2D_t *outer, rectangle2D_t *inner);
+int start_in_rectangle(rectangle2D_t *rec, recordStore_t *records, uint32_t id);
+int start_in_query(aggregateQuery_t *query, uint32_t id);
+void subtract_straddling(quadtreeNode_t *root, int depth, aggregateQuery_t *query);
+void aggregate_locations(quadtreeNode_t *leaf, aggregateQuery_t *query);
+void aggregate_query(quadtreeNode_t *root, int depth, aggregateQuery_t *query);
+void aggregate_quadtree(quadtreeNode_t *root, aggregateQuery_t *query);
 void remove_duplicate(node_t *head);
 void free_quadtree(quadtreeNode_t *root);
+int list_length(node_t *head);
+void collect_quadtree_stats(quadtreeNode_t *root, int depth, treeStats_t *stats);
+
+uint64_t spread_bits(uint32_t value);
+uint64_t morton_code(rectangle2D_t *rec, point2D_t *point);
+void sort_batch_queries(batchQuery_t *queries, batchQuery_t *scratch, int n);
+void batch_search_node(quadtreeNode_t *root, batchQuery_t *queries, batchQuery_t *scratch, int n, node_t **results);
+void batch_search_quadtree(quadtreeNode_t *root, double *points, int n, node_t **results);
 
 #endif
\ No newline at end of file
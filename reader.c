@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <errno.h>
+#include <unistd.h>
+#include "reader.h"
+
+/* powers of ten that are exact in a long double, the fast path of parse_double only scales by these */
+#if LDBL_MANT_DIG >= 64
+#define MAX_EXACT_POW10 27
+#define MAX_EXACT_MANTISSA UINT64_MAX
+#else
+#define MAX_EXACT_POW10 22
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+#endif
+
+long double exact_pow10[MAX_EXACT_POW10 + 1] = {
+  1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 
+  1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L,
+#if MAX_EXACT_POW10 > 22
+  1e23L, 1e24L, 1e25L, 1e26L, 1e27L
+#endif
+};
+
+/* 
+create a reader over the given input stream, binary == TRUE (1) if the stream holds packed doubles
+*/
+queryReader_t *create_query_reader(FILE *input, int binary) {
+  queryReader_t *reader = (queryReader_t *)malloc(sizeof(queryReader_t));
+  assert(reader);
+  reader->input = input;
+  reader->binary = binary;
+  reader->eof = 0;
+  reader->pos = reader->len = 0;
+  return reader;
+}
+
+void free_query_reader(queryReader_t *reader) {
+  free(reader);
+}
+
+/* 
+refill the buffer once every byte of it has been consumed, returns the number of bytes available. the buffer takes 
+whatever the stream holds at that moment (read), so queries written one at a time to a pipe are answered as they 
+come instead of once the buffer is full
+*/
+int fill_reader(queryReader_t *reader) {
+  if (reader->pos < reader->len) {
+    return reader->len - reader->pos;
+  }
+  if (reader->eof) {
+    return 0;
+  }
+  reader->pos = 0;
+  ssize_t length = 0;
+  do {
+    length = read(fileno(reader->input), reader->buffer, READER_BUFFER_SIZE);
+  } while (length < 0 && errno == EINTR);
+  reader->len = (length > 0) ? length : 0;
+  if (length <= 0) {
+    reader->eof = 1;
+  }
+  return reader->len;
+}
+
+/* 
+checks if the character separates two tokens
+*/
+int is_separator(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* 
+read the next whitespace separated token (at most MAX_QUERY_TOKEN_LENGTH - 1 characters are kept), 
+returns its length or 0 at the end of the stream. the buffer is scanned directly and only refilled 
+when a token (or the whitespace before it) reaches its end
+*/
+int read_token(queryReader_t *reader, char *token) {
+  int length = 0;
+  int in_token = 0;
+  while (fill_reader(reader) > 0) {
+    char *c = reader->buffer + reader->pos;
+    char *end = reader->buffer + reader->len;
+    if (!in_token) {
+      while (c < end && is_separator(*c)) {
+        c ++;
+      }
+      if (c == end) {
+        reader->pos = reader->len;
+        continue;
+      }
+      in_token = 1;
+    }
+    while (c < end && !is_separator(*c)) {
+      if (length < MAX_QUERY_TOKEN_LENGTH - 1) {
+        token[length ++] = *c;
+      }
+      c ++;
+    }
+    reader->pos = c - reader->buffer;
+    if (c < end) {
+      break;
+    }
+  }
+  token[length] = '\0';
+  return length;
+}
+
+/* 
+convert a token to a double, with the same value as (double)strtold(token, NULL). plain decimals with at most 
+MAX_FAST_DIGITS significant digits are accumulated as an integer and scaled once by an exact power of ten in long 
+double precision, which is correctly rounded just as strtold; every other token falls back to strtold
+*/
+double parse_double(char *token) {
+  char *c = token;
+  int negative = 0;
+  if (*c == '-' || *c == '+') {
+    negative = (*c == '-');
+    c ++;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int scale = 0;
+  int seen_digit = 0;
+  /* integer part, leading zeros are not significant */
+  for (; *c >= '0' && *c <= '9'; c ++) {
+    seen_digit = 1;
+    if (mantissa == 0 && *c == '0') {
+      continue;
+    }
+    if (digits == MAX_FAST_DIGITS) {
+      return (double)strtold(token, NULL);
+    }
+    mantissa = mantissa * 10 + (*c - '0');
+    digits ++;
+  }
+  if (*c == '.') {
+    c ++;
+    for (; *c >= '0' && *c <= '9'; c ++) {
+      seen_digit = 1;
+      scale --;
+      if (mantissa == 0 && *c == '0') {
+        continue;
+      }
+      if (digits == MAX_FAST_DIGITS) {
+        return (double)strtold(token, NULL);
+      }
+      mantissa = mantissa * 10 + (*c - '0');
+      digits ++;
+    }
+  }
+  if (!seen_digit) {
+    return (double)strtold(token, NULL);
+  }
+  if (*c == 'e' || *c == 'E') {
+    c ++;
+    int exp_negative = 0;
+    int exponent = 0;
+    if (*c == '-' || *c == '+') {
+      exp_negative = (*c == '-');
+      c ++;
+    }
+    if (*c < '0' || *c > '9') {
+      return (double)strtold(token, NULL);
+    }
+    for (; *c >= '0' && *c <= '9'; c ++) {
+      if (exponent > 10000) {
+        return (double)strtold(token, NULL);
+      }
+      exponent = exponent * 10 + (*c - '0');
+    }
+    scale += exp_negative ? -exponent : exponent;
+  }
+  /* trailing characters, or a mantissa/scale that cannot be converted with a single exact operation */
+  if (*c != '\0' || mantissa > MAX_EXACT_MANTISSA || scale > MAX_EXACT_POW10 || scale < -MAX_EXACT_POW10) {
+    return (double)strtold(token, NULL);
+  }
+  long double value = (long double)mantissa;
+  if (scale >= 0) {
+    value *= exact_pow10[scale];
+  } else {
+    value /= exact_pow10[-scale];
+  }
+  return (double)(negative ? -value : value);
+}
+
+/* 
+read the n values of the next query. text input: n tokens are read and converted, the tokens are kept to 
+be printed as given. binary input: n packed doubles are read and printed in a form that converts back to the same double (%.17g). 
+returns the number of values read, n unless the stream has ended
+*/
+int read_query(queryReader_t *reader, int n, char tokens[][MAX_QUERY_TOKEN_LENGTH], double *values) {
+  for (int i = 0; i < n; i ++) {
+    if (reader->binary) {
+      char *bytes = (char *)&values[i];
+      size_t copied = 0;
+      /* a value can be split between two fills of the buffer */
+      while (copied < sizeof(double)) {
+        size_t available = fill_reader(reader);
+        if (available == 0) {
+          return i;
+        }
+        size_t count = (available < sizeof(double) - copied) ? available : sizeof(double) - copied;
+        memcpy(bytes + copied, reader->buffer + reader->pos, count);
+        reader->pos += count;
+        copied += count;
+      }
+      snprintf(tokens[i], MAX_QUERY_TOKEN_LENGTH, "%.17g", values[i]);
+    } else {
+      if (read_token(reader, tokens[i]) == 0) {
+        return i;
+      }
+      values[i] = parse_double(tokens[i]);
+    }
+  }
+  return n;
+}
@@ -0,0 +1,31 @@
+#ifndef _READER_H_
+#define _READER_H_
+
+#include <stdio.h>
+
+#define READER_BUFFER_SIZE 65536
+#define MAX_QUERY_TOKEN_LENGTH 64
+/* longest decimal mantissa the fast path of parse_double accumulates exactly */
+#define MAX_FAST_DIGITS 19
+
+typedef struct queryReader queryReader_t;
+
+/* buffered reader of the query stream: whitespace separated numbers (text) or packed native doubles (binary) */
+struct queryReader {
+  FILE *input;
+  int binary;
+  int eof;
+  size_t pos;
+  size_t len;
+  char buffer[READER_BUFFER_SIZE];
+};
+
+queryReader_t *create_query_reader(FILE *input, int binary);
+void free_query_reader(queryReader_t *reader);
+int fill_reader(queryReader_t *reader);
+int is_separator(char c);
+int read_token(queryReader_t *reader, char *token);
+double parse_double(char *token);
+int read_query(queryReader_t *reader, int n, char tokens[][MAX_QUERY_TOKEN_LENGTH], double *values);
+
+#endif
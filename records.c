@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include "records.h"
+#include "arena.h"
+
+/* 
+create an empty string pool
+*/
+stringPool_t *create_string_pool() {
+  stringPool_t *pool = (stringPool_t *)malloc(sizeof(stringPool_t));
+  assert(pool);
+  pool->size = 0;
+  pool->capacity = INITIAL_POOL_CAPACITY;
+  pool->strings = (char **)malloc(sizeof(char *) * pool->capacity);
+  pool->table_size = 2 * INITIAL_POOL_CAPACITY;
+  pool->table = (int *)malloc(sizeof(int) * pool->table_size);
+  assert(pool->strings && pool->table);
+  memset(pool->table, -1, sizeof(int) * pool->table_size);
+  pool->bytes = 0;
+  return pool;
+}
+
+/* 
+FNV-1a hash of a string
+*/
+uint32_t hash_string(char *str) {
+  uint32_t hash = 2166136261u;
+  for (; *str != '\0'; str ++) {
+    hash ^= (unsigned char)*str;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/* 
+return the id of the given string in the pool, the string is copied into the pool the first time it is seen
+*/
+uint32_t intern_string(stringPool_t *pool, char *str) {
+  uint32_t slot = hash_string(str) & (pool->table_size - 1);
+  while (pool->table[slot] != -1) {
+    if (strcmp(pool->strings[pool->table[slot]], str) == 0) {
+      return pool->table[slot];
+    }
+    slot = (slot + 1) & (pool->table_size - 1);
+  }
+
+  if (pool->size == pool->capacity) {
+    pool->capacity *= 2;
+    pool->strings = (char **)realloc(pool->strings, sizeof(char *) * pool->capacity);
+    assert(pool->strings);
+  }
+  uint32_t id = pool->size ++;
+  pool->strings[id] = strdup(str);
+  assert(pool->strings[id]);
+  pool->bytes += strlen(str) + 1;
+  pool->table[slot] = id;
+
+  /* keep the hash table at most half full, re-insert every id into a table twice the size */
+  if (2 * pool->size > pool->table_size) {
+    free(pool->table);
+    pool->table_size *= 2;
+    pool->table = (int *)malloc(sizeof(int) * pool->table_size);
+    assert(pool->table);
+    memset(pool->table, -1, sizeof(int) * pool->table_size);
+    for (int i = 0; i < pool->size; i ++) {
+      slot = hash_string(pool->strings[i]) & (pool->table_size - 1);
+      while (pool->table[slot] != -1) {
+        slot = (slot + 1) & (pool->table_size - 1);
+      }
+      pool->table[slot] = i;
+    }
+  }
+  return id;
+}
+
+/* 
+return the id of the given string, or -1 if it is not in the pool
+*/
+int find_string(stringPool_t *pool, char *str) {
+  uint32_t slot = hash_string(str) & (pool->table_size - 1);
+  while (pool->table[slot] != -1) {
+    if (strcmp(pool->strings[pool->table[slot]], str) == 0) {
+      return pool->table[slot];
+    }
+    slot = (slot + 1) & (pool->table_size - 1);
+  }
+  return -1;
+}
+
+char *get_string(stringPool_t *pool, uint32_t id) {
+  assert(id < (uint32_t)pool->size);
+  return pool->strings[id];
+}
+
+void free_string_pool(stringPool_t *pool) {
+  for (int i = 0; i < pool->size; i ++) {
+    free(pool->strings[i]);
+  }
+  free(pool->strings);
+  free(pool->table);
+  free(pool);
+}
+
+/* 
+create an empty record store
+*/
+recordStore_t *create_record_store() {
+  recordStore_t *records = (recordStore_t *)malloc(sizeof(recordStore_t));
+  assert(records);
+  memset(records, 0, sizeof(recordStore_t));
+  records->strings = create_string_pool();
+  grow_record_store(records);
+  return records;
+}
+
+/* 
+double the capacity of every column (or allocate them with INITIAL_RECORD_CAPACITY rows)
+*/
+void grow_record_store(recordStore_t *records) {
+  records->capacity = (records->capacity == 0) ? INITIAL_RECORD_CAPACITY : 2 * records->capacity;
+  int n = records->capacity;
+  records->footpath_id = (int *)realloc(records->footpath_id, sizeof(int) * n);
+  records->address = (uint32_t *)realloc(records->address, sizeof(uint32_t) * n);
+  records->clue_sa = (uint32_t *)realloc(records->clue_sa, sizeof(uint32_t) * n);
+  records->asset_type = (uint32_t *)realloc(records->asset_type, sizeof(uint32_t) * n);
+  records->deltaz = (double *)realloc(records->deltaz, sizeof(double) * n);
+  records->distance = (double *)realloc(records->distance, sizeof(double) * n);
+  records->gradelin = (double *)realloc(records->gradelin, sizeof(double) * n);
+  records->mcc_id = (int *)realloc(records->mcc_id, sizeof(int) * n);
+  records->mccid_int = (int *)realloc(records->mccid_int, sizeof(int) * n);
+  records->rlmax = (double *)realloc(records->rlmax, sizeof(double) * n);
+  records->rlmin = (double *)realloc(records->rlmin, sizeof(double) * n);
+  records->segside = (uint32_t *)realloc(records->segside, sizeof(uint32_t) * n);
+  records->statusid = (int *)realloc(records->statusid, sizeof(int) * n);
+  records->streetid = (int *)realloc(records->streetid, sizeof(int) * n);
+  records->street_group = (int *)realloc(records->street_group, sizeof(int) * n);
+  records->start_lat = (double *)realloc(records->start_lat, sizeof(double) * n);
+  records->start_lon = (double *)realloc(records->start_lon, sizeof(double) * n);
+  records->end_lat = (double *)realloc(records->end_lat, sizeof(double) * n);
+  records->end_lon = (double *)realloc(records->end_lon, sizeof(double) * n);
+  assert(records->footpath_id && records->address && records->clue_sa && records->asset_type && records->deltaz &&
+  records->distance && records->gradelin && records->mcc_id && records->mccid_int && records->rlmax && records->rlmin &&
+  records->segside && records->statusid && records->streetid && records->street_group && records->start_lat && 
+  records->start_lon && records->end_lat && records->end_lon);
+  /* the columns are read by the queries as much as the quadtree, so they get the placement of the tree arena */
+  place_memory(records->footpath_id, sizeof(*records->footpath_id) * n);
+  place_memory(records->address, sizeof(*records->address) * n);
+  place_memory(records->clue_sa, sizeof(*records->clue_sa) * n);
+  place_memory(records->asset_type, sizeof(*records->asset_type) * n);
+  place_memory(records->deltaz, sizeof(*records->deltaz) * n);
+  place_memory(records->distance, sizeof(*records->distance) * n);
+  place_memory(records->gradelin, sizeof(*records->gradelin) * n);
+  place_memory(records->mcc_id, sizeof(*records->mcc_id) * n);
+  place_memory(records->mccid_int, sizeof(*records->mccid_int) * n);
+  place_memory(records->rlmax, sizeof(*records->rlmax) * n);
+  place_memory(records->rlmin, sizeof(*records->rlmin) * n);
+  place_memory(records->segside, sizeof(*records->segside) * n);
+  place_memory(records->statusid, sizeof(*records->statusid) * n);
+  place_memory(records->streetid, sizeof(*records->streetid) * n);
+  place_memory(records->street_group, sizeof(*records->street_group) * n);
+  place_memory(records->start_lat, sizeof(*records->start_lat) * n);
+  place_memory(records->start_lon, sizeof(*records->start_lon) * n);
+  place_memory(records->end_lat, sizeof(*records->end_lat) * n);
+  place_memory(records->end_lon, sizeof(*records->end_lon) * n);
+}
+
+/* 
+qsort comparison of two ints in ascending order
+*/
+int compare_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+/* 
+split the footpath ids of the stored records into ID_RANGES ranges of about the same number of records, called 
+once every record has been added
+*/
+void set_id_ranges(recordStore_t *records) {
+  int n = records->size;
+  if (n == 0) {
+    memset(records->id_bounds, 0, sizeof(records->id_bounds));
+    return;
+  }
+  int *ids = (int *)malloc(sizeof(int) * n);
+  assert(ids);
+  memcpy(ids, records->footpath_id, sizeof(int) * n);
+  qsort(ids, n, sizeof(int), compare_int);
+  for (int k = 0; k < ID_RANGES; k ++) {
+    records->id_bounds[k] = ids[(long)k * n / ID_RANGES];
+  }
+  free(ids);
+}
+
+/* 
+return the id range the given footpath id falls into: the last range whose smallest id is not above it (range 0 
+for ids below every range)
+*/
+int id_range(recordStore_t *records, int footpath_id) {
+  int low = 0, high = ID_RANGES - 1;
+  while (low < high) {
+    int mid = (low + high + 1) / 2;
+    if (records->id_bounds[mid] <= footpath_id) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return low;
+}
+
+/* 
+append the record given by the NUM_OF_FIELDS fields of a csv line, returns its record id
+*/
+uint32_t add_record(recordStore_t *records, char **fields) {
+  if (records->size == records->capacity) {
+    grow_record_store(records);
+  }
+  uint32_t id = records->size ++;
+  records->footpath_id[id] = atoi(fields[0]);
+  records->address[id] = intern_string(records->strings, fields[1]);
+  records->clue_sa[id] = intern_string(records->strings, fields[2]);
+  records->asset_type[id] = intern_string(records->strings, fields[3]);
+  records->deltaz[id] = strtod(fields[4], NULL);
+  records->distance[id] = strtod(fields[5], NULL);
+  records->gradelin[id] = strtod(fields[6], NULL);
+  records->mcc_id[id] = atoi(fields[7]);
+  records->mccid_int[id] = atoi(fields[8]);
+  records->rlmax[id] = strtod(fields[9], NULL);
+  records->rlmin[id] = strtod(fields[10], NULL);
+  records->segside[id] = intern_string(records->strings, fields[11]);
+  records->statusid[id] = atoi(fields[12]);
+  records->streetid[id] = atoi(fields[13]);
+  records->street_group[id] = atoi(fields[14]);
+  records->start_lat[id] = strtod(fields[15], NULL);
+  records->start_lon[id] = strtod(fields[16], NULL);
+  records->end_lat[id] = strtod(fields[17], NULL);
+  records->end_lon[id] = strtod(fields[18], NULL);
+  return id;
+}
+
+/* 
+the function prints the record with the given id to the specified output stream
+*/
+void print_record_to_file(FILE *output, recordStore_t *records, uint32_t id) {
+  char *specifier = "--> footpath_id: %d || address: %s || clue_sa: %s || asset_type: %s || deltaz: %.2lf ||"
+  " distance: %.2lf || grade1in: %.1lf || mcc_id: %d || mccid_int: %d || rlmax: %.2lf || rlmin: %.2lf || segside: %s ||"
+  " statusid: %d || streetid: %d || street_group: %d || start_lat: %.6lf || start_lon: %.6lf || end_lat: %.6lf ||"
+  " end_lon: %.6lf ||\n";
+  stringPool_t *strings = records->strings;
+  fprintf(output, specifier, records->footpath_id[id], get_string(strings, records->address[id]), 
+  get_string(strings, records->clue_sa[id]), get_string(strings, records->asset_type[id]), records->deltaz[id], 
+  records->distance[id], records->gradelin[id], records->mcc_id[id], records->mccid_int[id], records->rlmax[id], 
+  records->rlmin[id], get_string(strings, records->segside[id]), records->statusid[id], records->streetid[id], 
+  records->street_group[id], records->start_lat[id], records->start_lon[id], records->end_lat[id], records->end_lon[id]);
+}
+
+/* 
+the number of bytes used by the records: the filled part of the columns and the string pool
+*/
+long record_store_bytes(recordStore_t *records) {
+  long row_bytes = 9 * sizeof(double) + 6 * sizeof(int) + 4 * sizeof(uint32_t);
+  stringPool_t *pool = records->strings;
+  return records->size * row_bytes + pool->bytes + pool->size * sizeof(char *) + pool->table_size * sizeof(int);
+}
+
+void free_record_store(recordStore_t *records) {
+  if (records == NULL) {
+    return;
+  }
+  free(records->footpath_id);
+  free(records->address);
+  free(records->clue_sa);
+  free(records->asset_type);
+  free(records->deltaz);
+  free(records->distance);
+  free(records->gradelin);
+  free(records->mcc_id);
+  free(records->mccid_int);
+  free(records->rlmax);
+  free(records->rlmin);
+  free(records->segside);
+  free(records->statusid);
+  free(records->streetid);
+  free(records->street_group);
+  free(records->start_lat);
+  free(records->start_lon);
+  free(records->end_lat);
+  free(records->end_lon);
+  free_string_pool(records->strings);
+  free(records);
+}
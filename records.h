@@ -0,0 +1,71 @@
+#ifndef _RECORDS_H_
+#define _RECORDS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define INITIAL_RECORD_CAPACITY 1024
+#define INITIAL_POOL_CAPACITY 256
+/* number of footpath id ranges (quantiles) of the id summaries of the quadtree nodes */
+#define ID_RANGES 64
+
+typedef struct stringPool stringPool_t;
+typedef struct recordStore recordStore_t;
+
+/* deduplicated strings: each distinct string is stored once and referred to by its 32-bit id. table is an 
+open-addressing hash table of string ids (-1 == empty slot), table_size is a power of two */
+struct stringPool {
+  char **strings;
+  int size;
+  int capacity;
+  int *table;
+  int table_size;
+  long bytes;
+};
+
+/* columnar footpath records: field[record_id] for every field of a csv line, the string fields hold ids into the
+string pool. a record id is the position of the footpath in the input file */
+struct recordStore {
+  int size;
+  int capacity;
+  int *footpath_id;
+  uint32_t *address;
+  uint32_t *clue_sa;
+  uint32_t *asset_type;
+  double *deltaz;
+  double *distance;
+  double *gradelin;
+  int *mcc_id;
+  int *mccid_int;
+  double *rlmax;
+  double *rlmin;
+  uint32_t *segside;
+  int *statusid;
+  int *streetid;
+  int *street_group;
+  double *start_lat;
+  double *start_lon;
+  double *end_lat;
+  double *end_lon;
+  stringPool_t *strings;
+  /* id_bounds[k] is the smallest footpath_id of id range k, the ranges hold about the same number of records */
+  int id_bounds[ID_RANGES];
+};
+
+stringPool_t *create_string_pool();
+uint32_t hash_string(char *str);
+uint32_t intern_string(stringPool_t *pool, char *str);
+int find_string(stringPool_t *pool, char *str);
+char *get_string(stringPool_t *pool, uint32_t id);
+void free_string_pool(stringPool_t *pool);
+recordStore_t *create_record_store();
+void grow_record_store(recordStore_t *records);
+uint32_t add_record(recordStore_t *records, char **fields);
+void print_record_to_file(FILE *output, recordStore_t *records, uint32_t id);
+int compare_int(const void *a, const void *b);
+void set_id_ranges(recordStore_t *records);
+int id_range(recordStore_t *records, int footpath_id);
+long record_store_bytes(recordStore_t *records);
+void free_record_store(recordStore_t *records);
+
+#endif
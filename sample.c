@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include "quadtree.h"
+#include "stats.h"
+#include "records.h"
+#include "filter.h"
+#include "aggregate.h"
+#include "sample.h"
+
+struct dataPoint {
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
+};
+
+struct node {
+  dataPoint_t *data_point;
+  node_t *next;
+};
+
+struct quadtreeNode {
+  node_t *head;
+  rectangle2D_t *rectangle;
+  quadtreeNode_t *sw;
+  quadtreeNode_t *nw;
+  quadtreeNode_t *ne;
+  quadtreeNode_t *se;
+  quadtreeNode_t *bucket;
+  quadtreeNode_t *outside;
+  nodeSummary_t summary;
+  nodeAggregate_t aggregate;
+};
+
+/* 
+a level-of-detail query of sample_query: the query rectangle, the depth of its cells, an optional attribute filter, 
+and the footpaths of the cell being counted with the first of them (its representative)
+*/
+struct sampleQuery {
+  rectangle2D_t *range;
+  int depth;
+  attributeFilter_t *filter;
+  recordStore_t *records;
+  rectangle2D_t *root_rectangle;
+  FILE *output;
+  int cells;
+  int footpaths;
+  dataPoint_t *sample;
+};
+
+/* 
+a node a level-of-detail query still has to visit, with its depth
+*/
+struct sampleFrame {
+  quadtreeNode_t *node;
+  int depth;
+};
+
+/* 
+the depth of the cells of a level-of-detail query whose cells are at most size wide and high (at most 
+MAX_QUADTREE_DEPTH)
+*/
+int sample_depth_for_cell(quadtreeNode_t *root, double size) {
+  double area[4];
+  rectangle_area(root->rectangle, area);
+  double width = area[2] - area[0], height = area[3] - area[1];
+  int depth = 0;
+  while ((width > size || height > size) && depth < MAX_QUADTREE_DEPTH) {
+    width /= 2;
+    height /= 2;
+    depth ++;
+  }
+  return depth;
+}
+
+/* 
+the deepest depth at which the range rectangle overlaps at most count cells (one less if the root has an overflow 
+list, which is a cell of its own), so a level-of-detail query at that depth writes at most count cells. the cells 
+overlapped are bounded by the ones of a rectangle of the same size at the worst position
+*/
+int sample_depth_for_count(quadtreeNode_t *root, double *range, int count) {
+  double area[4];
+  rectangle_area(root->rectangle, area);
+  if (root->outside != NULL && count > 1) {
+    count --;
+  }
+  /* the part of the range rectangle within the root area */
+  double width = ((range[2] < area[2]) ? range[2] : area[2]) - ((range[0] > area[0]) ? range[0] : area[0]);
+  double height = ((range[3] < area[3]) ? range[3] : area[3]) - ((range[1] > area[1]) ? range[1] : area[1]);
+  width = (width > 0) ? width : 0;
+  height = (height > 0) ? height : 0;
+  int depth = 0;
+  while (depth < MAX_QUADTREE_DEPTH) {
+    double side = (double)(1L << (depth + 1));
+    double columns = width / ((area[2] - area[0]) / side) + 2;
+    double rows = height / ((area[3] - area[1]) / side) + 2;
+    columns = (columns < side) ? columns : side;
+    rows = (rows < side) ? rows : side;
+    if ((long)columns * (long)rows > count) {
+      break;
+    }
+    depth ++;
+  }
+  return depth;
+}
+
+/* 
+count the footpaths of a leaf node and its overflow bucket (or of the overflow list of the root, depth == 
+OUTSIDE_FRAME) that lie within the range rectangle and match the filter into the cell being counted, whose depth 
+is given. a footpath with both end points in the cell and the range rectangle is counted once, at its start point
+*/
+static void sample_locations(sampleQuery_t *query, quadtreeNode_t *leaf, int depth) {
+  attributeFilter_t *filter = query->filter;
+  for (; leaf != NULL; leaf = leaf->bucket) {
+    STATS_LEAF(list_length(leaf->head));
+    STATS_INC(points_tested);
+    if (!in_rectangle(query->range, &leaf->head->data_point->location)) {
+      continue;
+    }
+    if (filter != NULL && !filter_may_match(filter, &leaf->summary)) {
+      STATS_INC(subtrees_pruned);
+      continue;
+    }
+    for (node_t *ptr = leaf->head; ptr != NULL; ptr = ptr->next) {
+      dataPoint_t *data_point = ptr->data_point;
+      uint32_t id = data_point->record_id;
+      if (filter != NULL && !filter_matches_record(filter, id)) {
+        continue;
+      }
+      if (data_point->end_point && start_in_rectangle(query->range, query->records, id)) {
+        int same_cell = (depth == OUTSIDE_FRAME) ? !start_in_rectangle(query->root_rectangle, query->records, id) : 
+        data_point->shared_depth >= depth;
+        if (same_cell) {
+          continue;
+        }
+      }
+      if (query->sample == NULL) {
+        query->sample = data_point;
+      }
+      query->footpaths ++;
+    }
+  }
+}
+
+/* 
+count the footpaths of a cell (a node at the given depth, or the overflow list of the root if depth is 
+OUTSIDE_FRAME) within the range rectangle, and write the cell with its count and representative (the first footpath 
+found) to the output file, unless it has none. a cell that lies entirely within the range rectangle takes the count 
+of its aggregate and the first data point of its first leaf, without visiting the rest of its subtree; with an 
+attribute filter, the cells are counted point by point
+*/
+static void sample_cell(sampleQuery_t *query, quadtreeNode_t *cell, int depth) {
+  query->footpaths = 0;
+  query->sample = NULL;
+  if (depth == OUTSIDE_FRAME) {
+    sample_locations(query, cell->outside, OUTSIDE_FRAME);
+  } else if (query->filter == NULL && rectangle_contains(query->range, cell->rectangle)) {
+    query->footpaths = cell->aggregate.footpaths;
+    quadtreeNode_t *leaf = cell;
+    while (leaf != NULL && leaf->head == NULL) {
+      STATS_INC(nodes_visited);
+      quadtreeNode_t *children[] = {leaf->sw, leaf->nw, leaf->ne, leaf->se};
+      leaf = NULL;
+      for (int i = 0; i < 4 && leaf == NULL; i ++) {
+        leaf = children[i];
+      }
+    }
+    query->sample = (leaf != NULL) ? leaf->head->data_point : NULL;
+  } else {
+    sampleFrame_t stack[TRAVERSAL_STACK_SIZE];
+    int top = 0;
+    stack[top ++] = (sampleFrame_t){cell, depth};
+    while (top > 0) {
+      sampleFrame_t frame = stack[-- top];
+      quadtreeNode_t *node = frame.node;
+      STATS_INC(nodes_visited);
+      STATS_DEPTH(frame.depth);
+      if (node->head != NULL) {
+        sample_locations(query, node, depth);
+        continue;
+      }
+      assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+      for (int quadrant = SE; quadrant >= SW; quadrant --) {
+        quadtreeNode_t *child = get_child(node, quadrant);
+        if (child && rectangle_overlap(child->rectangle, query->range) && subtree_may_match(child, query->filter)) {
+          stack[top ++] = (sampleFrame_t){child, frame.depth + 1};
+        }
+      }
+    }
+  }
+  if (query->footpaths == 0 || query->sample == NULL) {
+    return;
+  }
+  query->cells ++;
+  if (depth == OUTSIDE_FRAME) {
+    fprintf(query->output, "outside: %d footpaths\n", query->footpaths);
+  } else {
+    double area[4];
+    rectangle_area(cell->rectangle, area);
+    fprintf(query->output, "cell %.6f %.6f %.6f %.6f: %d footpaths\n", area[0], area[1], area[2], area[3], 
+    query->footpaths);
+  }
+  print_record_to_file(query->output, query->records, query->sample->record_id);
+}
+
+/* 
+the function answers a level-of-detail query: for every occupied cell of the quadtree at the given depth (a leaf 
+node above that depth is a cell of its own, and so is the overflow list of the root) that holds footpaths within 
+the range rectangle matching the filter (NULL for none), one line with the cell and the number of those footpaths, 
+and one representative footpath, are written to the output file. the walk stops at the cells instead of visiting 
+every leaf. returns the number of cells written
+*/
+int sample_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, int depth, attributeFilter_t *filter, 
+recordStore_t *records, FILE *output) {
+  sampleQuery_t query = {range_rectangle, depth, filter, records, root->rectangle, output, 0, 0, NULL};
+  if (root->outside != NULL) {
+    STATS_DEPTH(0);
+    sample_cell(&query, root, OUTSIDE_FRAME);
+  }
+  if (!rectangle_overlap(root->rectangle, range_rectangle)) {
+    return query.cells;
+  }
+  sampleFrame_t stack[TRAVERSAL_STACK_SIZE];
+  int top = 0;
+  stack[top ++] = (sampleFrame_t){root, 0};
+  while (top > 0) {
+    sampleFrame_t frame = stack[-- top];
+    quadtreeNode_t *node = frame.node;
+    if (frame.depth == depth || node->head != NULL) {
+      sample_cell(&query, node, frame.depth);
+      continue;
+    }
+    STATS_INC(nodes_visited);
+    STATS_DEPTH(frame.depth);
+    /* the children are pushed in reverse, so the cells are written in the order SW, NW, NE, SE */
+    assert(top + SE + 1 <= TRAVERSAL_STACK_SIZE);
+    for (int quadrant = SE; quadrant >= SW; quadrant --) {
+      quadtreeNode_t *child = get_child(node, quadrant);
+      if (child && rectangle_overlap(child->rectangle, range_rectangle) && subtree_may_match(child, filter)) {
+        stack[top ++] = (sampleFrame_t){child, frame.depth + 1};
+      }
+    }
+  }
+  return query.cells;
+}
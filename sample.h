@@ -0,0 +1,18 @@
+#ifndef _SAMPLE_H_
+#define _SAMPLE_H_
+
+#include <stdio.h>
+
+typedef struct quadtreeNode quadtreeNode_t;
+typedef struct rectangle2D rectangle2D_t;
+typedef struct attributeFilter attributeFilter_t;
+typedef struct recordStore recordStore_t;
+typedef struct sampleQuery sampleQuery_t;
+typedef struct sampleFrame sampleFrame_t;
+
+int sample_depth_for_cell(quadtreeNode_t *root, double size);
+int sample_depth_for_count(quadtreeNode_t *root, double *range, int count);
+int sample_query(quadtreeNode_t *root, rectangle2D_t *range_rectangle, int depth, attributeFilter_t *filter, 
+recordStore_t *records, FILE *output);
+
+#endif
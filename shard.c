@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "data.h"
+#include "dict.h"
+#include "quadtree.h"
+#include "stage.h"
+#include "reader.h"
+#include "records.h"
+#include "shard.h"
+#include "arena.h"
+
+struct dataPoint {
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
+};
+
+struct node {
+  dataPoint_t *data_point;
+  node_t *next;
+};
+
+/* 
+split the root area (bottom left x, bottom left y, upper right x, upper right y) into a grid x grid grid of 
+shards, the snapshot of shard i is written to <prefix>.shard<i>.csv
+*/
+shardSet_t *create_shards(double *area, int grid, char *prefix) {
+  assert(grid > 0 && grid <= MAX_SHARD_GRID);
+  shardSet_t *set = (shardSet_t *)malloc(sizeof(shardSet_t));
+  assert(set);
+  memcpy(set->area, area, sizeof(set->area));
+  set->grid = grid;
+  set->size = grid * grid;
+  set->shards = (shard_t *)malloc(sizeof(shard_t) * set->size);
+  assert(set->shards);
+  double width = (area[2] - area[0]) / grid;
+  double height = (area[3] - area[1]) / grid;
+  for (int row = 0; row < grid; row ++) {
+    for (int column = 0; column < grid; column ++) {
+      shard_t *shard = &set->shards[row * grid + column];
+      shard->area[0] = area[0] + column * width;
+      shard->area[1] = area[1] + row * height;
+      /* the last row/column ends exactly on the root area */
+      shard->area[2] = (column == grid - 1) ? area[2] : area[0] + (column + 1) * width;
+      shard->area[3] = (row == grid - 1) ? area[3] : area[1] + (row + 1) * height;
+      snprintf(shard->snapshot, MAX_SHARD_PATH_CHAR, "%s.shard%d.csv", prefix, row * grid + column);
+      shard->pid = -1;
+      shard->requests = shard->responses = NULL;
+    }
+  }
+  return set;
+}
+
+/* 
+the function returns the value limited to [low, high]. the points and query rectangles outside the root area are 
+routed by their closest point of the root area
+*/
+double clamp_coordinate(double value, double low, double high) {
+  return (value < low) ? low : (value > high) ? high : value;
+}
+
+/* 
+tests whether the point (x, y) lies within the area of the shard (boundaries included)
+*/
+int shard_contains(shard_t *shard, double x, double y) {
+  return x >= shard->area[0] && x <= shard->area[2] && y >= shard->area[1] && y <= shard->area[3];
+}
+
+/* 
+tests whether the range (bottom left x, bottom left y, upper right x, upper right y) overlaps the area of the shard
+*/
+int shard_overlaps(shard_t *shard, double *range) {
+  return !(range[2] < shard->area[0] || range[0] > shard->area[2] || range[3] < shard->area[1] || 
+  range[1] > shard->area[3]);
+}
+
+/* 
+read the start_lat, start_lon, end_lat and end_lon of a csv line (its last four columns) into coordinates, 
+returns FALSE (0) if the line has fewer columns
+*/
+int footpath_end_points(char *line, double *coordinates) {
+  int position = strlen(line);
+  for (int i = TRAILING_COORDINATES - 1; i >= 0; i --) {
+    do {
+      position --;
+    } while (position >= 0 && line[position] != ',');
+    if (position < 0) {
+      return FALSE;
+    }
+    coordinates[i] = strtod(&line[position + 1], NULL);
+  }
+  return TRUE;
+}
+
+/* 
+the function reads the bounding box of the end points of the footpaths of the input into bounds (bottom left x, 
+bottom left y, upper right x, upper right y) and rewinds the input, returns FALSE (0) if there is no footpath
+*/
+int input_bounds(FILE *input, double *bounds) {
+  char line[MAX_LINE_CHAR + 1] = "";
+  fscanf(input, "%[^\n] ", line);
+  int found = FALSE;
+  double coordinates[TRAILING_COORDINATES];
+  while ((fscanf(input, "%[^\n] ", line)) == 1) {
+    if (!footpath_end_points(line, coordinates)) {
+      continue;
+    }
+    for (int i = 0; i < TRAILING_COORDINATES; i += 2) {
+      double x = coordinates[i + 1], y = coordinates[i];
+      if (!found) {
+        bounds[0] = bounds[2] = x;
+        bounds[1] = bounds[3] = y;
+        found = TRUE;
+      }
+      bounds[0] = (x < bounds[0]) ? x : bounds[0];
+      bounds[1] = (y < bounds[1]) ? y : bounds[1];
+      bounds[2] = (x > bounds[2]) ? x : bounds[2];
+      bounds[3] = (y > bounds[3]) ? y : bounds[3];
+    }
+  }
+  rewind(input);
+  return found;
+}
+
+/* 
+the function writes the snapshot of every shard: the header line of the input and the lines of the footpaths with
+an end point in the area of the shard, so a footpath crossing shards is stored by both of them. an end point outside 
+the root area belongs to the shard of its closest point of the root area, whose quadtree keeps it in its overflow list
+*/
+void write_shard_snapshots(FILE *input, shardSet_t *set) {
+  FILE **snapshots = (FILE **)malloc(sizeof(FILE *) * set->size);
+  assert(snapshots);
+  char line[MAX_LINE_CHAR + 1] = "";
+  fscanf(input, "%[^\n] ", line);
+  for (int i = 0; i < set->size; i ++) {
+    snapshots[i] = fopen(set->shards[i].snapshot, "w");
+    assert(snapshots[i]);
+    fprintf(snapshots[i], "%s\n", line);
+  }
+
+  double coordinates[TRAILING_COORDINATES];
+  while ((fscanf(input, "%[^\n] ", line)) == 1) {
+    if (!footpath_end_points(line, coordinates)) {
+      continue;
+    }
+    for (int i = 0; i < TRAILING_COORDINATES; i += 2) {
+      coordinates[i] = clamp_coordinate(coordinates[i], set->area[1], set->area[3]);
+      coordinates[i + 1] = clamp_coordinate(coordinates[i + 1], set->area[0], set->area[2]);
+    }
+    for (int i = 0; i < set->size; i ++) {
+      if (shard_contains(&set->shards[i], coordinates[1], coordinates[0]) || 
+      shard_contains(&set->shards[i], coordinates[3], coordinates[2])) {
+        fprintf(snapshots[i], "%s\n", line);
+      }
+    }
+  }
+  for (int i = 0; i < set->size; i ++) {
+    fclose(snapshots[i]);
+  }
+  free(snapshots);
+}
+
+/* 
+fork a shard process for every shard, connected to the coordinator by a request pipe and a response pipe
+*/
+void start_shards(shardSet_t *set, int stage, options_t *options) {
+  fflush(stdout);
+  for (int i = 0; i < set->size; i ++) {
+    shard_t *shard = &set->shards[i];
+    int requests[2], responses[2];
+    assert(pipe(requests) == 0 && pipe(responses) == 0);
+    shard->pid = fork();
+    assert(shard->pid >= 0);
+    if (shard->pid == 0) {
+      /* the pipes of the shards started before are only used by the coordinator */
+      for (int j = 0; j < i; j ++) {
+        close(fileno(set->shards[j].requests));
+        close(fileno(set->shards[j].responses));
+      }
+      close(requests[1]);
+      close(responses[0]);
+      shard->requests = fdopen(requests[0], "r");
+      shard->responses = fdopen(responses[1], "w");
+      assert(shard->requests && shard->responses);
+      if (options->pin && pin_to_cpu(i) < 0) {
+        fprintf(stderr, "could not pin shard %d to a CPU\n", i);
+      }
+      run_shard(shard, stage, options);
+      fflush(shard->responses);
+      /* the buffers inherited from the coordinator are not flushed again */
+      _exit(EXIT_SUCCESS);
+    }
+    close(requests[0]);
+    close(responses[1]);
+    shard->requests = fdopen(requests[1], "w");
+    shard->responses = fdopen(responses[0], "r");
+    assert(shard->requests && shard->responses);
+  }
+}
+
+/* 
+the body of a shard process: build the quadtree of the shard from its snapshot, then answer the requests of the 
+coordinator until SHARD_EXIT. every record found is sent as a line "footpath_id record" in the order of the 
+unsharded query, followed by SHARD_END_OF_RESPONSE
+*/
+void run_shard(shard_t *shard, int stage, options_t *options) {
+  /* the search paths printed by the queries are not part of the response */
+  assert(freopen("/dev/null", "w", stdout));
+  set_quadtree_frame(shard->area);
+  FILE *input = fopen(shard->snapshot, "r");
+  assert(input);
+  dict_t *dict = create_empty_dictionary();
+  make_dictionary(input, dict);
+  fclose(input);
+  recordStore_t *records = dictionary_records(dict);
+  quadtreeNode_t *root = create_empty_quadtree(create_rectangle(create_point(shard->area[0], shard->area[1]), 
+  create_point(shard->area[2], shard->area[3])));
+  make_quadtree(root, dict);
+  attributeFilter_t *filter = NULL;
+  if (options->filtered) {
+    filter = &options->filter;
+    filter->records = records;
+    if (filter->has_asset_type) {
+      filter->asset_type = find_string(records->strings, options->asset_type);
+    }
+  }
+
+  int type;
+  double values[4];
+  while (fscanf(shard->requests, "%d", &type) == 1 && type != SHARD_EXIT) {
+    if (type == SHARD_POINT_QUERY && fscanf(shard->requests, "%lf %lf", &values[0], &values[1]) == 2) {
+      node_t *head = search_quadtree_node_by_point(root, values[0], values[1], FALSE);
+      for (node_t *ptr = head; ptr != NULL; ptr = ptr->next) {
+        fprintf(shard->responses, "%d ", ptr->data_point->footpath_id);
+        print_record_to_file(shard->responses, records, ptr->data_point->record_id);
+      }
+    } else if (type == SHARD_RANGE_QUERY && 
+    fscanf(shard->requests, "%lf %lf %lf %lf", &values[0], &values[1], &values[2], &values[3]) == 4) {
+      point2D_t *range_bot_left = create_point(values[0], values[1]);
+      point2D_t *range_up_right = create_point(values[2], values[3]);
+      rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
+      node_t *head = (node_t *)malloc(sizeof(node_t));
+      assert(head);
+      head->data_point = NULL;
+      head->next = NULL;
+      range_query(root, range_rectangle, filter, &head);
+      remove_duplicate(head);
+      for (node_t *ptr = head; ptr != NULL && ptr->data_point != NULL; ptr = ptr->next) {
+        fprintf(shard->responses, "%d ", ptr->data_point->footpath_id);
+        print_record_to_file(shard->responses, records, ptr->data_point->record_id);
+      }
+      while (head != NULL) {
+        node_t *h = head;
+        head = head->next;
+        free(h);
+      }
+      free(range_bot_left);
+      free(range_up_right);
+      free(range_rectangle);
+    }
+    fputs(SHARD_END_OF_RESPONSE, shard->responses);
+    fflush(shard->responses);
+  }
+  free_quadtree(root);
+  free_dictionary(dict);
+  release_tree_arena();
+}
+
+/* 
+read the response of a shard to the last request sent to it
+*/
+void read_shard_response(shard_t *shard, shardResponse_t *response) {
+  response->size = 0;
+  response->next = 0;
+  char line[MAX_SHARD_LINE_CHAR];
+  while (fgets(line, MAX_SHARD_LINE_CHAR, shard->responses) != NULL && strcmp(line, SHARD_END_OF_RESPONSE) != 0) {
+    if (response->size == response->capacity) {
+      response->capacity = (response->capacity == 0) ? INITIAL_BATCH_SIZE : 2 * response->capacity;
+      response->footpath_ids = (int *)realloc(response->footpath_ids, sizeof(int) * response->capacity);
+      response->lines = (char **)realloc(response->lines, sizeof(char *) * response->capacity);
+      assert(response->footpath_ids && response->lines);
+    }
+    char *record = NULL;
+    response->footpath_ids[response->size] = strtol(line, &record, 10);
+    response->lines[response->size] = strdup(record + 1);
+    assert(response->lines[response->size]);
+    response->size ++;
+  }
+}
+
+void free_shard_response(shardResponse_t *response) {
+  for (int i = 0; i < response->size; i ++) {
+    free(response->lines[i]);
+  }
+  response->size = 0;
+}
+
+/* 
+write the records of n shard responses to output in ascending footpath_id order, a footpath returned by several 
+shards (its end points lie in different shards) is written once
+*/
+void merge_shard_responses(FILE *output, shardResponse_t *responses, int n) {
+  int last_id = 0, written = FALSE;
+  while (TRUE) {
+    shardResponse_t *smallest = NULL;
+    for (int i = 0; i < n; i ++) {
+      if (responses[i].next < responses[i].size && (smallest == NULL || 
+      responses[i].footpath_ids[responses[i].next] < smallest->footpath_ids[smallest->next])) {
+        smallest = &responses[i];
+      }
+    }
+    if (smallest == NULL) {
+      return;
+    }
+    int id = smallest->footpath_ids[smallest->next];
+    if (!written || id != last_id) {
+      fputs(smallest->lines[smallest->next], output);
+    }
+    last_id = id;
+    written = TRUE;
+    smallest->next ++;
+  }
+}
+
+/* 
+ask every shard process to exit, wait for it and remove its snapshot
+*/
+void stop_shards(shardSet_t *set) {
+  for (int i = 0; i < set->size; i ++) {
+    fprintf(set->shards[i].requests, "%d\n", SHARD_EXIT);
+    fclose(set->shards[i].requests);
+    fclose(set->shards[i].responses);
+    waitpid(set->shards[i].pid, NULL, 0);
+    remove(set->shards[i].snapshot);
+  }
+  free(set->shards);
+  free(set);
+}
+
+/* 
+the function executes s3/s4 program over a grid of options->shards x options->shards shards: the input is split 
+into the snapshots of the shards (next to the output file), one process per shard builds its quadtree, and every 
+query is sent only to the shards it concerns; a point query to the first shard that contains the point, a range 
+query to every shard it overlaps, whose answers are merged in footpath_id order. stdout shows the shards of each 
+query instead of the search path
+*/
+void perform_sharded_stage(int stage, FILE *input, FILE *output, char *output_name, double *area, options_t *options) {
+  assert(stage == SHARD_POINT_QUERY || stage == SHARD_RANGE_QUERY);
+  /* --auto-bounds/--square-bounds need a first pass over the input */
+  if (options->bounds != BOUNDS_ARGUMENTS) {
+    double bounds[4];
+    fit_root_area(options, input_bounds(input, bounds) ? bounds : NULL, area);
+  }
+  shardSet_t *set = create_shards(area, options->shards, output_name);
+  write_shard_snapshots(input, set);
+  fflush(output);
+  start_shards(set, stage, options);
+
+  shardResponse_t *responses = (shardResponse_t *)calloc(set->size, sizeof(shardResponse_t));
+  assert(responses);
+  queryReader_t *reader = create_query_reader(stdin, options->binary_queries);
+  /* a point query is two co-ordinates, a range query four */
+  int tokens = (stage == SHARD_POINT_QUERY) ? 2 : 4;
+  char str_query[4][MAX_QUERY_TOKEN_LENGTH];
+  double query[4];
+  while (read_query(reader, tokens, str_query, query) == tokens) {
+    int n = 0;
+    /* the query as routed: limited to the root area */
+    double routed[4];
+    for (int i = 0; i < tokens; i += 2) {
+      routed[i] = clamp_coordinate(query[i], set->area[0], set->area[2]);
+      routed[i + 1] = clamp_coordinate(query[i + 1], set->area[1], set->area[3]);
+    }
+    if (stage == SHARD_POINT_QUERY) {
+      printf("%s %s -->", str_query[0], str_query[1]);
+      fprintf(output, "%s %s\n", str_query[0], str_query[1]);
+      for (int i = 0; i < set->size; i ++) {
+        if (shard_contains(&set->shards[i], routed[0], routed[1])) {
+          printf(" shard %d", i);
+          fprintf(set->shards[i].requests, "%d %.17g %.17g\n", SHARD_POINT_QUERY, query[0], query[1]);
+          fflush(set->shards[i].requests);
+          read_shard_response(&set->shards[i], &responses[n ++]);
+          break;
+        }
+      }
+      /* the records of a location are written as they are stored, the same footpath can be there twice */
+      for (int i = 0; n > 0 && i < responses[0].size; i ++) {
+        fputs(responses[0].lines[i], output);
+      }
+    } else {
+      printf("%s %s %s %s -->", str_query[0], str_query[1], str_query[2], str_query[3]);
+      fprintf(output, "%s %s %s %s\n", str_query[0], str_query[1], str_query[2], str_query[3]);
+      /* scatter the query to the overlapping shards first, so they answer it in parallel */
+      int *targets = (int *)malloc(sizeof(int) * set->size);
+      assert(targets);
+      for (int i = 0; i < set->size; i ++) {
+        if (shard_overlaps(&set->shards[i], routed)) {
+          printf(" shard %d", i);
+          fprintf(set->shards[i].requests, "%d %.17g %.17g %.17g %.17g\n", SHARD_RANGE_QUERY, query[0], query[1], 
+          query[2], query[3]);
+          fflush(set->shards[i].requests);
+          targets[n ++] = i;
+        }
+      }
+      for (int i = 0; i < n; i ++) {
+        read_shard_response(&set->shards[targets[i]], &responses[i]);
+      }
+      merge_shard_responses(output, responses, n);
+      free(targets);
+    }
+    printf("\n");
+    for (int i = 0; i < n; i ++) {
+      free_shard_response(&responses[i]);
+    }
+  }
+  for (int i = 0; i < set->size; i ++) {
+    free(responses[i].footpath_ids);
+    free(responses[i].lines);
+  }
+  free(responses);
+  free_query_reader(reader);
+  stop_shards(set);
+}
@@ -0,0 +1,67 @@
+#ifndef _SHARD_H_
+#define _SHARD_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#define MAX_SHARD_LINE_CHAR 4096
+#define MAX_SHARD_PATH_CHAR 1024
+/* the largest grid of --shards: every shard is a process with a snapshot file and two pipes open at once */
+#define MAX_SHARD_GRID 16
+/* request types sent to a shard process, one request per line: the type followed by the co-ordinates */
+#define SHARD_EXIT 0
+#define SHARD_POINT_QUERY 3
+#define SHARD_RANGE_QUERY 4
+/* a shard ends every response with this line */
+#define SHARD_END_OF_RESPONSE ".\n"
+/* columns of the start/end point of a footpath, counted from the end of a csv line */
+#define TRAILING_COORDINATES 4
+
+typedef struct shard shard_t;
+typedef struct shardSet shardSet_t;
+typedef struct shardResponse shardResponse_t;
+typedef struct options options_t;
+
+/* one cell of the grid of shards: its area, its snapshot (the csv lines of the footpaths with an end point in the 
+cell) and the pipes to the shard process that answers its queries */
+struct shard {
+  double area[4];
+  char snapshot[MAX_SHARD_PATH_CHAR];
+  pid_t pid;
+  FILE *requests;
+  FILE *responses;
+};
+
+/* a grid x grid grid of shards over the root area */
+struct shardSet {
+  double area[4];
+  int grid;
+  int size;
+  shard_t *shards;
+};
+
+/* the answer of a shard to a query: its records in ascending footpath_id order */
+struct shardResponse {
+  int size;
+  int capacity;
+  int *footpath_ids;
+  char **lines;
+  int next;
+};
+
+shardSet_t *create_shards(double *area, int grid, char *prefix);
+double clamp_coordinate(double value, double low, double high);
+int shard_contains(shard_t *shard, double x, double y);
+int shard_overlaps(shard_t *shard, double *range);
+int footpath_end_points(char *line, double *coordinates);
+int input_bounds(FILE *input, double *bounds);
+void write_shard_snapshots(FILE *input, shardSet_t *set);
+void start_shards(shardSet_t *set, int stage, options_t *options);
+void run_shard(shard_t *shard, int stage, options_t *options);
+void read_shard_response(shard_t *shard, shardResponse_t *response);
+void free_shard_response(shardResponse_t *response);
+void merge_shard_responses(FILE *output, shardResponse_t *responses, int n);
+void stop_shards(shardSet_t *set);
+void perform_sharded_stage(int stage, FILE *input, FILE *output, char *output_name, double *area, options_t *options);
+
+#endif
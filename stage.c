@@ -2,14 +2,32 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
 #include "data.h"
 #include "dict.h"
 #include "quadtree.h"
 #include "stage.h"
+#include "stats.h"
+#include "reader.h"
+#include "records.h"
+#include "aggregate.h"
+#include "join.h"
+#include "polygon.h"
+#include "page.h"
+#include "sample.h"
+#include "index.h"
+#include "feed.h"
+#include "shard.h"
+#include "arena.h"
 
 struct dataPoint {
-  data_t *data;
-  point2D_t *location;
+  uint32_t record_id;
+  int footpath_id;
+  point2D_t location;
+  uint8_t end_point;
+  int16_t shared_depth;
 };
 
 struct node {
@@ -17,86 +35,690 @@ struct node {
   node_t *next;
 };
 
+/* 
+parse the value of a numeric option as a whole number from min to max, or exit with a usage error
+*/
+static int parse_whole_number(const char *option, const char *text, long min, long max) {
+  char *end = NULL;
+  errno = 0;
+  long value = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || errno == ERANGE || value < min || value > max) {
+    if (max == INT_MAX) {
+      fprintf(stderr, "%s expects a whole number of %ld or more: %s\n", option, min, text);
+    } else {
+      fprintf(stderr, "%s expects a whole number from %ld to %ld: %s\n", option, min, max, text);
+    }
+    exit(EXIT_FAILURE);
+  }
+  return (int)value;
+}
+
+/* 
+parse the value of a numeric option as a number from min to max (-HUGE_VAL and HUGE_VAL for no bound), or exit 
+with a usage error
+*/
+static double parse_number(const char *option, const char *text, double min, double max) {
+  char *end = NULL;
+  double value = strtod(text, &end);
+  if (end == text || *end != '\0' || !(value >= min && value <= max)) {
+    if (isinf(min) && isinf(max)) {
+      fprintf(stderr, "%s expects a number: %s\n", option, text);
+    } else if (isinf(max)) {
+      fprintf(stderr, "%s expects a number of %g or more: %s\n", option, min, text);
+    } else {
+      fprintf(stderr, "%s expects a number from %g to %g: %s\n", option, min, max, text);
+    }
+    exit(EXIT_FAILURE);
+  }
+  return value;
+}
+
+/* 
+parse the optional flags that follow the root area on the command line
+*/
+void parse_options(int argc, char **argv, options_t *options) {
+  options->tree_stats = FALSE;
+  options->query_stats = FALSE;
+  options->max_depth = DEFAULT_MAX_DEPTH;
+  options->min_cell_size = DEFAULT_MIN_CELL_SIZE;
+  options->batch = FALSE;
+  options->binary_queries = FALSE;
+  options->filtered = FALSE;
+  options->asset_type = NULL;
+  init_filter(&options->filter);
+  options->aggregate = FALSE;
+  options->limit = 0;
+  options->cursor = INT_MIN;
+  options->join = NULL;
+  options->polygon = NULL;
+  options->distance = 0;
+  options->shards = 0;
+  options->bounds = BOUNDS_ARGUMENTS;
+  options->unordered = FALSE;
+  options->huge_pages = FALSE;
+  options->interleave = FALSE;
+  options->pin = FALSE;
+  options->sample_cell = -1;
+  options->sample_count = 0;
+  options->write_index = NULL;
+  options->index = FALSE;
+  options->follow = FALSE;
+  options->feed = NULL;
+  for (int i = FIRST_OPTION_INDEX; i < argc; i ++) {
+    if (strcmp(argv[i], OPT_STATS) == 0) {
+      options->tree_stats = TRUE;
+    } else if (strcmp(argv[i], OPT_QUERY_STATS) == 0) {
+      options->query_stats = TRUE;
+    } else if (strcmp(argv[i], OPT_MAX_DEPTH) == 0 && i + 1 < argc) {
+      options->max_depth = parse_whole_number(argv[i], argv[i + 1], 0, MAX_QUADTREE_DEPTH);
+      i ++;
+    } else if (strcmp(argv[i], OPT_MIN_CELL) == 0 && i + 1 < argc) {
+      options->min_cell_size = parse_number(argv[i], argv[i + 1], 0, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_BATCH) == 0) {
+      options->batch = TRUE;
+    } else if (strcmp(argv[i], OPT_BINARY_QUERIES) == 0) {
+      options->binary_queries = TRUE;
+    } else if (strcmp(argv[i], OPT_ASSET_TYPE) == 0 && i + 1 < argc) {
+      options->filter.has_asset_type = options->filtered = TRUE;
+      options->asset_type = argv[++ i];
+    } else if (strcmp(argv[i], OPT_STATUSID) == 0 && i + 1 < argc) {
+      options->filter.has_statusid = options->filtered = TRUE;
+      options->filter.statusid = parse_whole_number(argv[i], argv[i + 1], 0, INT_MAX);
+      i ++;
+    } else if (strcmp(argv[i], OPT_STREET_GROUP) == 0 && i + 1 < argc) {
+      options->filter.has_street_group = options->filtered = TRUE;
+      options->filter.street_group = parse_whole_number(argv[i], argv[i + 1], 0, INT_MAX);
+      i ++;
+    } else if (strcmp(argv[i], OPT_MIN_GRADE) == 0 && i + 1 < argc) {
+      options->filtered = TRUE;
+      options->filter.min_gradelin = parse_number(argv[i], argv[i + 1], -HUGE_VAL, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_MAX_GRADE) == 0 && i + 1 < argc) {
+      options->filtered = TRUE;
+      options->filter.max_gradelin = parse_number(argv[i], argv[i + 1], -HUGE_VAL, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_MIN_DISTANCE) == 0 && i + 1 < argc) {
+      options->filtered = TRUE;
+      options->filter.min_distance = parse_number(argv[i], argv[i + 1], 0, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_MAX_DISTANCE) == 0 && i + 1 < argc) {
+      options->filtered = TRUE;
+      options->filter.max_distance = parse_number(argv[i], argv[i + 1], 0, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_AGGREGATE) == 0) {
+      options->aggregate = TRUE;
+    } else if (strcmp(argv[i], OPT_LIMIT) == 0 && i + 1 < argc) {
+      options->limit = parse_whole_number(argv[i], argv[i + 1], 1, MAX_PAGE_LIMIT);
+      i ++;
+    } else if (strcmp(argv[i], OPT_CURSOR) == 0 && i + 1 < argc) {
+      options->cursor = parse_whole_number(argv[i], argv[i + 1], 0, INT_MAX);
+      i ++;
+    } else if (strcmp(argv[i], OPT_JOIN) == 0 && i + 1 < argc) {
+      options->join = argv[++ i];
+    } else if (strcmp(argv[i], OPT_POLYGON) == 0 && i + 1 < argc) {
+      options->polygon = argv[++ i];
+    } else if (strcmp(argv[i], OPT_DISTANCE) == 0 && i + 1 < argc) {
+      options->distance = parse_number(argv[i], argv[i + 1], 0, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_SHARDS) == 0 && i + 1 < argc) {
+      options->shards = parse_whole_number(argv[i], argv[i + 1], 1, MAX_SHARD_GRID);
+      i ++;
+    } else if (strcmp(argv[i], OPT_AUTO_BOUNDS) == 0) {
+      options->bounds = BOUNDS_TIGHT;
+    } else if (strcmp(argv[i], OPT_SQUARE_BOUNDS) == 0) {
+      options->bounds = BOUNDS_SQUARE;
+    } else if (strcmp(argv[i], OPT_UNORDERED) == 0) {
+      options->unordered = TRUE;
+    } else if (strcmp(argv[i], OPT_HUGE_PAGES) == 0) {
+      options->huge_pages = TRUE;
+    } else if (strcmp(argv[i], OPT_INTERLEAVE) == 0) {
+      options->interleave = TRUE;
+    } else if (strcmp(argv[i], OPT_PIN) == 0) {
+      options->pin = TRUE;
+    } else if (strcmp(argv[i], OPT_SAMPLE_CELL) == 0 && i + 1 < argc) {
+      options->sample_cell = parse_number(argv[i], argv[i + 1], 0, HUGE_VAL);
+      i ++;
+    } else if (strcmp(argv[i], OPT_SAMPLE_COUNT) == 0 && i + 1 < argc) {
+      options->sample_count = parse_whole_number(argv[i], argv[i + 1], 1, INT_MAX);
+      i ++;
+    } else if (strcmp(argv[i], OPT_WRITE_INDEX) == 0 && i + 1 < argc) {
+      options->write_index = argv[++ i];
+    } else if (strcmp(argv[i], OPT_INDEX) == 0) {
+      options->index = TRUE;
+    } else if (strcmp(argv[i], OPT_FOLLOW) == 0) {
+      options->follow = TRUE;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", argv[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/* 
+read the root area given on the command line into area (bottom left x, bottom left y, upper right x, upper right y)
+*/
+void read_root_area(char **argv, double *area) {
+  area[0] = (double)strtold(argv[START_LON_INDEX], NULL);
+  area[1] = (double)strtold(argv[START_LAT_INDEX], NULL);
+  area[2] = (double)strtold(argv[END_LON_INDEX], NULL);
+  area[3] = (double)strtold(argv[END_LAT_INDEX], NULL);
+}
+
+/* 
+set the frame of the co-ordinates (set_quadtree_frame) to the root area before the dataset is read. with 
+-DQUADTREE_FIXED_POINT the points are created relative to it, so --auto-bounds/--square-bounds read the bounding 
+box in a first pass over the input (input_bounds) instead of while the dataset is read
+*/
+void prepare_root_area(FILE *input, options_t *options, double *area) {
+#ifdef QUADTREE_FIXED_POINT
+  if (options->bounds != BOUNDS_ARGUMENTS) {
+    double bounds[4];
+    fit_root_area(options, input_bounds(input, bounds) ? bounds : NULL, area);
+  }
+#endif
+  set_quadtree_frame(area);
+}
+
+/* 
+apply the memory placement options before anything is read: --huge-pages/--interleave allocate the quadtree from the 
+tree arena, --pin pins this process to a CPU. with --shards the shard processes are pinned when they start instead 
+(start_shards), each one to a CPU of its own
+*/
+void prepare_placement(options_t *options) {
+  if (options->huge_pages || options->interleave) {
+    enable_tree_arena(options->huge_pages, options->interleave);
+  }
+  if (options->pin && options->shards == 0 && pin_to_cpu(0) < 0) {
+    fprintf(stderr, "could not pin the process to a CPU\n");
+  }
+}
+
+/* 
+with --auto-bounds or --square-bounds, replace the root area by the bounding box of the footpaths (made square 
+by align_square_area for --square-bounds). bounds is NULL when there are no footpaths, the area is then kept
+*/
+void fit_root_area(options_t *options, double *bounds, double *area) {
+  if (options->bounds == BOUNDS_ARGUMENTS || bounds == NULL) {
+    return;
+  }
+  memcpy(area, bounds, 4 * sizeof(double));
+  if (options->bounds == BOUNDS_SQUARE) {
+    align_square_area(area);
+  }
+}
+
+/* 
+read the next query (see read_query). with --follow, the rows appended to the input file until the query arrived 
+are added to the quadtree before it is answered, and the answers written so far are flushed before waiting for 
+the next query
+*/
+int read_next_query(queryReader_t *reader, int n, char tokens[][MAX_QUERY_TOKEN_LENGTH], double *values, 
+options_t *options) {
+  if (options->feed == NULL) {
+    return read_query(reader, n, tokens, values);
+  }
+  /* the separators left after the last query do not count as a waiting query */
+  while (!reader->binary && reader->pos < reader->len && is_separator(reader->buffer[reader->pos])) {
+    reader->pos ++;
+  }
+  if (reader->pos >= reader->len) {
+    fflush(NULL);
+  }
+  int count = read_query(reader, n, tokens, values);
+  if (count == n && poll_feed(options->feed) > 0 && options->filtered && options->filter.has_asset_type && 
+  options->filter.asset_type < 0) {
+    /* the asset_type may have first appeared in the new rows */
+    options->filter.asset_type = find_string(options->filter.records->strings, options->asset_type);
+  }
+  return count;
+}
+
+/* 
+collect and print the --stats report of the built quadtree
+*/
+void report_quadtree_stats(FILE *output, quadtreeNode_t *root, recordStore_t *records) {
+  treeStats_t stats;
+  memset(&stats, 0, sizeof(treeStats_t));
+  collect_quadtree_stats(root, 0, &stats);
+  stats.record_bytes = record_store_bytes(records);
+  stats.records = records->size;
+  stats.distinct_strings = records->strings->size;
+  print_tree_stats(output, &stats);
+}
+
 /*
 the function executes s3 program. it accepts co-ordinate pair(s) from stdin and search for the node at that 
 position in the quadtree
 */
-void perform_stage_3(FILE *output, quadtreeNode_t *root) {
-  long double point_query_x = 0.0;
-  long double point_query_y = 0.0;
-  char str_point_query_x[MAX_NUMBER_LENGTH] = "";
-  char str_point_query_y[MAX_NUMBER_LENGTH] = "";
-
-  while ((scanf("%s %s", str_point_query_x, str_point_query_y)) == 2) {
-    printf("%s %s -->", str_point_query_x, str_point_query_y);
-    fprintf(output, "%s %s\n", str_point_query_x, str_point_query_y);
-    point_query_x = strtold(str_point_query_x, NULL);
-    point_query_y = strtold(str_point_query_y, NULL);
-    point2D_t *target = create_point(point_query_x, point_query_y);
-    node_t *head = search_quadtree_node_by_point(root, target, TRUE);
+void perform_stage_3(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options) {
+  queryReader_t *reader = create_query_reader(stdin, options->binary_queries);
+  if (options->batch) {
+    perform_stage_3_batch(output, root, records, reader);
+    free_query_reader(reader);
+    return;
+  }
+  char str_point_query[2][MAX_QUERY_TOKEN_LENGTH];
+  double point_query[2];
+
+  while (read_next_query(reader, 2, str_point_query, point_query, options) == 2) {
+    printf("%s %s -->", str_point_query[0], str_point_query[1]);
+    fprintf(output, "%s %s\n", str_point_query[0], str_point_query[1]);
+    reset_query_stats();
+    node_t *head = search_quadtree_node_by_point(root, point_query[0], point_query[1], TRUE);
     printf("\n");
+    if (options->query_stats) {
+      char label[2 * MAX_QUERY_TOKEN_LENGTH + 1];
+      sprintf(label, "%s %s", str_point_query[0], str_point_query[1]);
+      print_query_stats(stderr, label);
+    }
       
     if (head != NULL) {
       node_t *ptr = head;
       while (ptr != NULL) {
-        print_data_to_file(output, ptr->data_point->data);
+        print_record_to_file(output, records, ptr->data_point->record_id);
         ptr = ptr->next;
       }
     }
-    free(target);
   }
+  free_query_reader(reader);
+}
+
+/*
+the function executes s3 program in batch mode. every co-ordinate pair is read from the reader first, then all of 
+them are looked up at once with batch_search_quadtree and the records are printed in the input order. the search 
+paths are not followed one query at a time, so only the queries are printed to stdout
+*/
+void perform_stage_3_batch(FILE *output, quadtreeNode_t *root, recordStore_t *records, queryReader_t *reader) {
+  int capacity = INITIAL_BATCH_SIZE;
+  int n = 0;
+  /* the co-ordinates of query i are targets[2 * i] and targets[2 * i + 1] */
+  double *targets = (double *)malloc(sizeof(double) * 2 * capacity);
+  /* the query texts are kept back to back in one buffer ("x y\0" each), offsets[i] is where query i starts */
+  size_t text_capacity = INITIAL_BATCH_SIZE * MAX_QUERY_TOKEN_LENGTH;
+  size_t text_length = 0;
+  char *texts = (char *)malloc(text_capacity);
+  size_t *offsets = (size_t *)malloc(sizeof(size_t) * capacity);
+  assert(targets && texts && offsets);
+  char str_point_query[2][MAX_QUERY_TOKEN_LENGTH];
+  double point_query[2];
+
+  while (read_query(reader, 2, str_point_query, point_query) == 2) {
+    if (n == capacity) {
+      capacity *= 2;
+      targets = (double *)realloc(targets, sizeof(double) * 2 * capacity);
+      offsets = (size_t *)realloc(offsets, sizeof(size_t) * capacity);
+      assert(targets && offsets);
+    }
+    if (text_length + 2 * MAX_QUERY_TOKEN_LENGTH > text_capacity) {
+      text_capacity *= 2;
+      texts = (char *)realloc(texts, text_capacity);
+      assert(texts);
+    }
+    offsets[n] = text_length;
+    text_length += sprintf(texts + text_length, "%s %s", str_point_query[0], str_point_query[1]) + 1;
+    targets[2 * n] = point_query[0];
+    targets[2 * n + 1] = point_query[1];
+    n ++;
+  }
+
+  node_t **results = (node_t **)malloc(sizeof(node_t *) * (n + 1));
+  assert(results);
+  batch_search_quadtree(root, targets, n, results);
+
+  for (int i = 0; i < n; i ++) {
+    printf("%s -->\n", texts + offsets[i]);
+    fprintf(output, "%s\n", texts + offsets[i]);
+    for (node_t *ptr = results[i]; ptr != NULL; ptr = ptr->next) {
+      print_record_to_file(output, records, ptr->data_point->record_id);
+    }
+  }
+  free(results);
+  free(targets);
+  free(texts);
+  free(offsets);
 }
 
 /* 
 the function executes s4 program. it accepts two pair of co-ordinates representing bottom left and 
 upper right vertex respectively, it constructs a range rectangle and searches for all the nodes that lie
-within the range rectangle in the quadtree
-*/
-void perform_stage_4(FILE *output, quadtreeNode_t *root) {
-  long double bot_left_x = 0.0;
-  long double bot_left_y = 0.0;
-  long double up_right_x = 0.0;
-  long double up_right_y = 0.0;
-    char str_bot_left_x[MAX_NUMBER_LENGTH] = "";
-    char str_bot_left_y[MAX_NUMBER_LENGTH] = "";
-    char str_up_right_x[MAX_NUMBER_LENGTH] = "";
-    char str_up_right_y[MAX_NUMBER_LENGTH] = "";
-
-    while ((scanf("%s %s %s %s", str_bot_left_x, str_bot_left_y, str_up_right_x, str_up_right_y)) == 4) {
-      bot_left_x = strtold(str_bot_left_x, NULL);
-      bot_left_y = strtold(str_bot_left_y, NULL);
-      up_right_x = strtold(str_up_right_x, NULL);
-      up_right_y = strtold(str_up_right_y, NULL);
-      printf("%s %s %s %s -->", str_bot_left_x, str_bot_left_y, str_up_right_x, str_up_right_y);
-      fprintf(output, "%s %s %s %s\n", str_bot_left_x, str_bot_left_y, str_up_right_x, str_up_right_y);
-
-      point2D_t *range_bot_left = create_point(bot_left_x, bot_left_y);
-      point2D_t *range_up_right = create_point(up_right_x, up_right_y);
-      rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
-
-      node_t *head = (node_t *)malloc(sizeof(node_t));
-      assert(head);
-      head->data_point = NULL;
-      head->next = NULL;
-      range_query(root, range_rectangle, &head);
-      remove_duplicate(head);
-
-      printf("\n");
+within the range rectangle in the quadtree (and match the attribute filter of the options, if any)
+*/
+void perform_stage_4(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options) {
+  attributeFilter_t *filter = NULL;
+  if (options->filtered) {
+    filter = &options->filter;
+    filter->records = records;
+    if (filter->has_asset_type) {
+      filter->asset_type = find_string(records->strings, options->asset_type);
+    }
+  }
+  if (options->join != NULL) {
+    perform_stage_4_join(output, root, records, options);
+    return;
+  }
+  if (options->polygon != NULL) {
+    perform_stage_4_polygon(output, root, records, options);
+    return;
+  }
+  queryReader_t *reader = create_query_reader(stdin, options->binary_queries);
+  if (options->aggregate) {
+    perform_stage_4_aggregate(output, root, records, options, reader);
+    free_query_reader(reader);
+    return;
+  }
+  if (options->sample_cell >= 0 || options->sample_count > 0) {
+    perform_stage_4_sample(output, root, records, options, reader);
+    free_query_reader(reader);
+    return;
+  }
+  if (options->limit > 0) {
+    perform_stage_4_page(output, root, records, options, reader);
+    free_query_reader(reader);
+    return;
+  }
+  if (options->unordered) {
+    perform_stage_4_unordered(output, root, records, options, reader);
+    free_query_reader(reader);
+    return;
+  }
+  /* bottom left x, bottom left y, upper right x, upper right y */
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
 
-      node_t *ptr = head;
-      while (ptr != NULL && ptr->data_point != NULL) {
-        print_data_to_file(output, ptr->data_point->data);
-        ptr = ptr->next;
-      }
+  while (read_next_query(reader, 4, str_range, range, options) == 4) {
+    printf("%s %s %s %s -->", str_range[0], str_range[1], str_range[2], str_range[3]);
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+
+    point2D_t *range_bot_left = create_point(range[0], range[1]);
+    point2D_t *range_up_right = create_point(range[2], range[3]);
+    rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
+
+    node_t *head = (node_t *)malloc(sizeof(node_t));
+    assert(head);
+    head->data_point = NULL;
+    head->next = NULL;
+    reset_query_stats();
+    range_query(root, range_rectangle, filter, &head);
+    remove_duplicate(head);
+
+    printf("\n");
+    if (options->query_stats) {
+      char label[4 * MAX_QUERY_TOKEN_LENGTH + 3];
+      sprintf(label, "%s %s %s %s", str_range[0], str_range[1], str_range[2], str_range[3]);
+      print_query_stats(stderr, label);
+    }
+
+    node_t *ptr = head;
+    while (ptr != NULL && ptr->data_point != NULL) {
+      print_record_to_file(output, records, ptr->data_point->record_id);
+      ptr = ptr->next;
+    }
+
+    node_t *h = NULL;
+    while (head != NULL) {
+      h = head;
+      head = head->next;
+      free(h);
+    }
+    free(range_bot_left);
+    free(range_up_right);
+    free(range_rectangle);
+  }
+  free_query_reader(reader);
+}
+
+/* 
+the function executes s4 program with the --aggregate option: for every range query, print the number of footpaths
+within the range rectangle, their total distance, mean deltaz and grade1in histogram instead of their records. 
+only the queries are printed to stdout
+*/
+void perform_stage_4_aggregate(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader) {
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
+  aggregateQuery_t query;
+  query.filter = (options->filtered) ? &options->filter : NULL;
+  query.records = records;
 
-      node_t *h = NULL;
-      while (head != NULL) {
-        h = head;
-        head = head->next;
-        free(h);
+  while (read_next_query(reader, 4, str_range, range, options) == 4) {
+    printf("%s %s %s %s -->\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+
+    point2D_t *range_bot_left = create_point(range[0], range[1]);
+    point2D_t *range_up_right = create_point(range[2], range[3]);
+    query.range = create_rectangle(range_bot_left, range_up_right);
+    reset_query_stats();
+    aggregate_quadtree(root, &query);
+    if (options->query_stats) {
+      char label[4 * MAX_QUERY_TOKEN_LENGTH + 3];
+      sprintf(label, "%s %s %s %s", str_range[0], str_range[1], str_range[2], str_range[3]);
+      print_query_stats(stderr, label);
+    }
+    print_aggregate(output, &query.result);
+
+    free(range_bot_left);
+    free(range_up_right);
+    free(query.range);
+  }
+}
+
+/* 
+the function executes s4 program with the --limit option: for every range query, write the records of the first 
+options->limit footpaths within the range rectangle whose footpath_id is above options->cursor. stdout shows the 
+cursor of the next page (the last footpath_id of this page), or that this is the last page
+*/
+void perform_stage_4_page(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader) {
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
+  attributeFilter_t *filter = (options->filtered) ? &options->filter : NULL;
+  uint32_t *results = (uint32_t *)malloc(sizeof(uint32_t) * options->limit);
+  assert(results);
+
+  while (read_next_query(reader, 4, str_range, range, options) == 4) {
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    point2D_t *range_bot_left = create_point(range[0], range[1]);
+    point2D_t *range_up_right = create_point(range[2], range[3]);
+    rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
+    reset_query_stats();
+    int count = page_query(root, range_rectangle, filter, records, options->cursor, options->limit, results);
+    if (count == options->limit) {
+      printf("%s %s %s %s --> next cursor: %d\n", str_range[0], str_range[1], str_range[2], str_range[3], 
+      records->footpath_id[results[count - 1]]);
+    } else {
+      printf("%s %s %s %s --> last page\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    }
+    if (options->query_stats) {
+      char label[4 * MAX_QUERY_TOKEN_LENGTH + 3];
+      sprintf(label, "%s %s %s %s", str_range[0], str_range[1], str_range[2], str_range[3]);
+      print_query_stats(stderr, label);
+    }
+    for (int i = 0; i < count; i ++) {
+      print_record_to_file(output, records, results[i]);
+    }
+
+    free(range_bot_left);
+    free(range_up_right);
+    free(range_rectangle);
+  }
+  free(results);
+}
+
+/* 
+the function executes s4 program with the --unordered option: the footpaths within the range rectangle are read from 
+a range cursor a batch at a time and written as they are found, so a query needs no list of its results. a footpath 
+with both end points within the range rectangle is written at its start point
+*/
+void perform_stage_4_unordered(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader) {
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
+  attributeFilter_t *filter = (options->filtered) ? &options->filter : NULL;
+  dataPoint_t *batch[RANGE_BATCH_SIZE];
+
+  while (read_next_query(reader, 4, str_range, range, options) == 4) {
+    printf("%s %s %s %s -->", str_range[0], str_range[1], str_range[2], str_range[3]);
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    point2D_t *range_bot_left = create_point(range[0], range[1]);
+    point2D_t *range_up_right = create_point(range[2], range[3]);
+    rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
+    reset_query_stats();
+
+    rangeCursor_t *cursor = open_range_cursor(root, range_rectangle, filter, TRUE);
+    int n;
+    while ((n = next_range_batch(cursor, batch, RANGE_BATCH_SIZE)) > 0) {
+      for (int i = 0; i < n; i ++) {
+        uint32_t id = batch[i]->record_id;
+        if (!batch[i]->end_point || !start_in_rectangle(range_rectangle, records, id)) {
+          print_record_to_file(output, records, id);
+        }
       }
-      free(range_bot_left);
-      free(range_up_right);
-      free(range_rectangle);
     }
+    close_range_cursor(cursor);
+
+    printf("\n");
+    if (options->query_stats) {
+      char label[4 * MAX_QUERY_TOKEN_LENGTH + 3];
+      sprintf(label, "%s %s %s %s", str_range[0], str_range[1], str_range[2], str_range[3]);
+      print_query_stats(stderr, label);
+    }
+    free(range_bot_left);
+    free(range_up_right);
+    free(range_rectangle);
+  }
+}
+
+/* 
+the function executes s4 program with the --sample-cell or --sample-count option: for each range query, the 
+occupied quadtree cells of the chosen depth are written to the output file, each one with the number of its footpaths 
+within the range rectangle and one of them as its representative. stdout shows the number of cells and their depth
+*/
+void perform_stage_4_sample(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader) {
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
+  attributeFilter_t *filter = (options->filtered) ? &options->filter : NULL;
+
+  while (read_next_query(reader, 4, str_range, range, options) == 4) {
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    int depth = (options->sample_cell >= 0) ? sample_depth_for_cell(root, options->sample_cell) : 
+    sample_depth_for_count(root, range, options->sample_count);
+
+    point2D_t *range_bot_left = create_point(range[0], range[1]);
+    point2D_t *range_up_right = create_point(range[2], range[3]);
+    rectangle2D_t *range_rectangle = create_rectangle(range_bot_left, range_up_right);
+    reset_query_stats();
+    int cells = sample_query(root, range_rectangle, depth, filter, records, output);
+    printf("%s %s %s %s --> %d cells at depth %d\n", str_range[0], str_range[1], str_range[2], str_range[3], cells, 
+    depth);
+    if (options->query_stats) {
+      char label[4 * MAX_QUERY_TOKEN_LENGTH + 3];
+      sprintf(label, "%s %s %s %s", str_range[0], str_range[1], str_range[2], str_range[3]);
+      print_query_stats(stderr, label);
+    }
+
+    free(range_bot_left);
+    free(range_up_right);
+    free(range_rectangle);
+  }
+}
+
+/* 
+with --write-index, write the compressed index of the records to the given file
+*/
+void write_index_file(options_t *options, recordStore_t *records) {
+  if (options->write_index == NULL) {
+    return;
+  }
+  FILE *output = fopen(options->write_index, "wb");
+  assert(output);
+  write_index(output, records);
+  fclose(output);
+}
+
+/* 
+the function executes s4 program with the --index option: the input file is a compressed index, and each range 
+query only decodes the blocks it touches. the output file is the same as for the csv file the index was written 
+from, stdout shows the blocks of each query instead of the search path
+*/
+void perform_stage_4_index(FILE *input, FILE *output, options_t *options) {
+  footpathIndex_t *index = open_index(input);
+  attributeFilter_t *filter = NULL;
+  if (options->filtered) {
+    filter = &options->filter;
+    filter->records = index->records;
+    if (filter->has_asset_type) {
+      filter->asset_type = find_string(index->records->strings, options->asset_type);
+    }
+  }
+  queryReader_t *reader = create_query_reader(stdin, options->binary_queries);
+  char str_range[4][MAX_QUERY_TOKEN_LENGTH];
+  double range[4];
+
+  while (read_query(reader, 4, str_range, range) == 4) {
+    printf("%s %s %s %s -->", str_range[0], str_range[1], str_range[2], str_range[3]);
+    fprintf(output, "%s %s %s %s\n", str_range[0], str_range[1], str_range[2], str_range[3]);
+    uint32_t *results = NULL;
+    int count = index_range_query(index, range, filter, TRUE, &results);
+    printf("\n");
+    for (int i = 0; i < count; i ++) {
+      print_record_to_file(output, index->records, results[i]);
+    }
+    free(results);
+  }
+  free_query_reader(reader);
+  close_index(index);
+}
+
+/* 
+the function executes s4 program with the --join option: the stops are read from the given csv file and every 
+(stop, footpath_id) pair within the join distance is written to the output file, no query is read from stdin
+*/
+void perform_stage_4_join(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options) {
+  FILE *input = fopen(options->join, "r");
+  assert(input);
+  stopSet_t *stops = read_stops(input);
+  fclose(input);
+
+  fprintf(output, "stop_id,footpath_id\n");
+  reset_query_stats();
+  long pairs = spatial_join(root, stops, options->distance, (options->filtered) ? &options->filter : NULL, records, output);
+  printf("%d stops of %s --> %ld pairs\n", stops->size, options->join, pairs);
+  if (options->query_stats) {
+    print_query_stats(stderr, options->join);
+  }
+  free_stops(stops);
+}
+
+/* 
+the function executes s4 program with the --polygon option: the polygons are read from the given csv file, and for 
+each one its id and the footpaths with an end point within it (in footpath_id order) are written to the output 
+file, no query is read from stdin. stdout shows the number of footpaths and of the nodes found inside and crossing 
+the polygon instead of the search path
+*/
+void perform_stage_4_polygon(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options) {
+  FILE *input = fopen(options->polygon, "r");
+  assert(input);
+  polygonSet_t *polygons = read_polygons(input);
+  fclose(input);
+
+  for (int i = 0; i < polygons->size; i ++) {
+    polygon_t *polygon = polygons->polygons[i];
+    fprintf(output, "%s\n", polygon->id);
+    long cells[3] = {0, 0, 0};
+    uint32_t *results = NULL;
+    reset_query_stats();
+    int count = polygon_query(root, polygon, (options->filtered) ? &options->filter : NULL, records, &results, cells);
+    printf("%s --> %d footpaths, %ld inside and %ld crossing nodes\n", polygon->id, count, cells[POLYGON_INSIDE], 
+    cells[POLYGON_CROSSING]);
+    if (options->query_stats) {
+      print_query_stats(stderr, polygon->id);
+    }
+    for (int k = 0; k < count; k ++) {
+      print_record_to_file(output, records, results[k]);
+    }
+    free(results);
+  }
+  free_polygons(polygons);
 }
\ No newline at end of file
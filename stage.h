@@ -1,17 +1,146 @@
 #ifndef _STAGE_H_
 #define _STAGE_H_
 
+#include "filter.h"
+#include "reader.h"
+
 #define INPUT_FILE_INDEX 2
 #define OUTPUT_FILE_INDEX 3
 #define START_LON_INDEX 4
 #define START_LAT_INDEX 5
 #define END_LON_INDEX 6
 #define END_LAT_INDEX 7
+#define FIRST_OPTION_INDEX 8
+
+#define OPT_STATS "--stats"
+#define OPT_QUERY_STATS "--query-stats"
+#define OPT_MAX_DEPTH "--max-depth"
+#define OPT_MIN_CELL "--min-cell"
+#define OPT_BATCH "--batch"
+#define OPT_BINARY_QUERIES "--binary-queries"
+#define OPT_ASSET_TYPE "--asset-type"
+#define OPT_STATUSID "--statusid"
+#define OPT_STREET_GROUP "--street-group"
+#define OPT_MIN_GRADE "--min-grade"
+#define OPT_MAX_GRADE "--max-grade"
+#define OPT_MIN_DISTANCE "--min-distance"
+#define OPT_MAX_DISTANCE "--max-distance"
+#define OPT_AGGREGATE "--aggregate"
+#define OPT_LIMIT "--limit"
+#define OPT_CURSOR "--cursor"
+#define OPT_JOIN "--join"
+#define OPT_DISTANCE "--distance"
+#define OPT_SHARDS "--shards"
+#define OPT_AUTO_BOUNDS "--auto-bounds"
+#define OPT_SQUARE_BOUNDS "--square-bounds"
+#define OPT_UNORDERED "--unordered"
+#define OPT_HUGE_PAGES "--huge-pages"
+#define OPT_INTERLEAVE "--interleave"
+#define OPT_PIN "--pin"
+#define OPT_POLYGON "--polygon"
+#define OPT_SAMPLE_CELL "--sample-cell"
+#define OPT_SAMPLE_COUNT "--sample-count"
+#define OPT_WRITE_INDEX "--write-index"
+#define OPT_INDEX "--index"
+#define OPT_FOLLOW "--follow"
+
+/* where the root area comes from */
+#define BOUNDS_ARGUMENTS 0
+#define BOUNDS_TIGHT 1
+#define BOUNDS_SQUARE 2
+
+#define INITIAL_BATCH_SIZE 1024
+/* the largest page of --limit, its results are allocated up front */
+#define MAX_PAGE_LIMIT 1000000
 
 typedef struct dataPoint dataPoint_t;
 typedef struct node node_t;
+typedef struct options options_t;
+typedef struct queryReader queryReader_t;
+typedef struct recordStore recordStore_t;
+typedef struct footpathFeed footpathFeed_t;
+
+/* optional flags given after the root area, e.g. ./dict4 4 data.csv out.txt x1 y1 x2 y2 --stats */
+struct options {
+  /* --stats: print the shape/memory report of the built quadtree to stderr */
+  int tree_stats;
+  /* --query-stats: print the hot-path counters of every query to stderr (needs -DQUADTREE_STATS) */
+  int query_stats;
+  /* --max-depth N / --min-cell SIZE: limits below which leaf nodes become overflow buckets */
+  int max_depth;
+  double min_cell_size;
+  /* --batch: read every stage 3 query first and look them up together with batch_search_quadtree */
+  int batch;
+  /* --binary-queries: stdin holds packed native doubles (2 per stage 3 query, 4 per stage 4 query) */
+  int binary_queries;
+  /* --asset-type STR, --statusid N, --street-group N, --min-grade/--max-grade X (grade 1-in), --min-distance/
+  --max-distance X: stage 4 only returns the footpaths matching every given attribute. filter.asset_type is 
+  resolved from asset_type once the records are read */
+  int filtered;
+  char *asset_type;
+  attributeFilter_t filter;
+  /* --aggregate: stage 4 prints the count, sums and grade1in histogram of the footpaths instead of the records */
+  int aggregate;
+  /* --limit N [--cursor ID]: stage 4 only returns the first N footpaths whose footpath_id is above ID (a page) */
+  int limit;
+  int cursor;
+  /* --join FILE --distance D: instead of reading queries, stage 4 writes every (stop, footpath_id) pair of a 
+  footpath with an end point within D of a stop of FILE (csv with the columns id,lon,lat) */
+  char *join;
+  double distance;
+  /* --shards K: split the root area into a K x K grid of shards, each one built and queried by a process of its own */
+  int shards;
+  /* --auto-bounds / --square-bounds: the root area is the bounding box of the footpaths (BOUNDS_TIGHT), or the 
+  smallest aligned square with a power of two side that contains it (BOUNDS_SQUARE), instead of the arguments */
+  int bounds;
+  /* --unordered: stage 4 writes the footpaths of a range query as they are found instead of in footpath_id order */
+  int unordered;
+  /* --huge-pages / --interleave: allocate the quadtree from the tree arena, on transparent huge pages and/or 
+  interleaved across the NUMA nodes; the record columns get the same placement */
+  int huge_pages;
+  int interleave;
+  /* --pin: pin the process (with --shards, every shard process) to a CPU of its own */
+  int pin;
+  /* --polygon FILE: instead of reading queries, stage 4 writes the footpaths with an end point within each polygon 
+  of FILE (csv with the columns id,lon1,lat1,lon2,lat2,...) */
+  char *polygon;
+  /* --sample-cell SIZE / --sample-count N: stage 4 writes one representative footpath and the number of footpaths 
+  of every occupied cell of at most SIZE wide and high, or of the deepest cells of which a query overlaps at most N. 
+  sample_cell is -1 and sample_count 0 when they are not given */
+  double sample_cell;
+  int sample_count;
+  /* --write-index FILE: write the compressed index of the records to FILE once the dataset is read */
+  char *write_index;
+  /* --index: the dataset is a compressed index (see --write-index), stage 4 answers the range queries from it */
+  int index;
+  /* --follow: keep reading the rows appended to the input file, they are added to the quadtree before each query. 
+  feed is set once the quadtree is built */
+  int follow;
+  footpathFeed_t *feed;
+};
 
-void perform_stage_3(FILE *output, quadtreeNode_t *root);
-void perform_stage_4(FILE *output, quadtreeNode_t *root);
+void parse_options(int argc, char **argv, options_t *options);
+void read_root_area(char **argv, double *area);
+void prepare_root_area(FILE *input, options_t *options, double *area);
+void prepare_placement(options_t *options);
+void fit_root_area(options_t *options, double *bounds, double *area);
+int read_next_query(queryReader_t *reader, int n, char tokens[][MAX_QUERY_TOKEN_LENGTH], double *values, 
+options_t *options);
+void report_quadtree_stats(FILE *output, quadtreeNode_t *root, recordStore_t *records);
+void perform_stage_3(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options);
+void perform_stage_3_batch(FILE *output, quadtreeNode_t *root, recordStore_t *records, queryReader_t *reader);
+void perform_stage_4_aggregate(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader);
+void perform_stage_4_page(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader);
+void perform_stage_4_unordered(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader);
+void perform_stage_4_join(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options);
+void perform_stage_4_sample(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options,
+queryReader_t *reader);
+void write_index_file(options_t *options, recordStore_t *records);
+void perform_stage_4_index(FILE *input, FILE *output, options_t *options);
+void perform_stage_4_polygon(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options);
+void perform_stage_4(FILE *output, quadtreeNode_t *root, recordStore_t *records, options_t *options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "quadtree.h"
+#include "stats.h"
+
+#ifdef QUADTREE_STATS
+queryStats_t query_stats;
+#endif
+
+/* 
+reset the per-query counters, called before each query so the counters describe that query only
+*/
+void reset_query_stats() {
+#ifdef QUADTREE_STATS
+  memset(&query_stats, 0, sizeof(queryStats_t));
+  /* the first node entered (the root) is at depth 0 */
+  query_stats.depth = -1;
+#endif
+}
+
+/* 
+print the per-query counters as a single key=value line, prefixed by the given label (the query itself),
+so the counters can be exported and matched with the results of the same query
+*/
+void print_query_stats(FILE *output, char *label) {
+#ifdef QUADTREE_STATS
+  double avg_depth = (query_stats.leaves_tested > 0) ? (double)query_stats.depth_sum / query_stats.leaves_tested : 0.0;
+  fprintf(output, "%s --> nodes_visited=%ld leaves_tested=%ld points_tested=%ld points_emitted=%ld subtrees_pruned=%ld"
+  " max_depth=%d avg_depth=%.2lf max_coincident=%d allocations=%ld\n", label, query_stats.nodes_visited, query_stats.leaves_tested,
+  query_stats.points_tested, query_stats.points_emitted, query_stats.subtrees_pruned, query_stats.max_depth, avg_depth, 
+  query_stats.max_coincident, query_stats.allocations);
+#else
+  fprintf(output, "%s --> query statistics unavailable, rebuild with -DQUADTREE_STATS\n", label);
+#endif
+}
+
+/* 
+print the report collected by collect_quadtree_stats: node counts, the depth histogram of the occupied 
+leaves, the empty-leaf ratio and the number of bytes used by each component of the tree
+*/
+void print_tree_stats(FILE *output, treeStats_t *stats) {
+  long leaves = stats->leaf_nodes + stats->empty_leaves;
+  long total_nodes = stats->internal_nodes + stats->leaf_nodes;
+  long total_bytes = stats->node_bytes + stats->rectangle_bytes + stats->list_bytes + stats->data_point_bytes + stats->record_bytes;
+  fprintf(output, "root: %.17g %.17g %.17g %.17g\n", stats->root_area[0], stats->root_area[1], stats->root_area[2], 
+  stats->root_area[3]);
+  fprintf(output, "quadtree nodes: %ld (internal: %ld, occupied leaves: %ld, empty leaves: %ld)\n", total_nodes, 
+  stats->internal_nodes, stats->leaf_nodes, stats->empty_leaves);
+  fprintf(output, "empty-leaf ratio: %.3lf\n", (leaves > 0) ? (double)stats->empty_leaves / leaves : 0.0);
+  fprintf(output, "overflow buckets: %ld (extra locations: %ld)\n", stats->bucket_leaves, stats->bucket_locations);
+  fprintf(output, "outside the root: %ld data points (locations: %ld)\n", stats->outside_points, stats->outside_locations);
+  fprintf(output, "data points: %ld (longest list at a coincident location: %d)\n", stats->list_entries, stats->max_list_length);
+  fprintf(output, "max depth: %d\n", stats->max_depth);
+  fprintf(output, "depth histogram (occupied leaves):\n");
+  for (int depth = 0; depth <= STATS_MAX_DEPTH && depth <= stats->max_depth; depth ++) {
+    if (stats->depth_histogram[depth] > 0) {
+      fprintf(output, "  %s%2d: %ld\n", (depth == STATS_MAX_DEPTH) ? ">=" : "", depth, stats->depth_histogram[depth]);
+    }
+  }
+  fprintf(output, "records: %ld (distinct strings: %ld)\n", stats->records, stats->distinct_strings);
+  fprintf(output, "bytes: nodes %ld || rectangles %ld || lists %ld || data points %ld || records %ld || total %ld\n", 
+  stats->node_bytes, stats->rectangle_bytes, stats->list_bytes, stats->data_point_bytes, stats->record_bytes, total_bytes);
+}
@@ -0,0 +1,77 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdio.h>
+
+#define STATS_MAX_DEPTH 64
+
+typedef struct queryStats queryStats_t;
+typedef struct treeStats treeStats_t;
+
+/* counters collected along the hot paths of quadtree.c; only updated when the program is compiled 
+with -DQUADTREE_STATS, otherwise every STATS_* macro expands to nothing */
+struct queryStats {
+  long nodes_visited;
+  long leaves_tested;
+  long points_tested;
+  long points_emitted;
+  long subtrees_pruned;
+  long allocations;
+  long depth_sum;
+  int depth;
+  int max_depth;
+  int max_coincident;
+};
+
+/* shape and memory footprint of a built quadtree, collected by walking the tree for the --stats report; 
+depth_histogram[d] counts the occupied leaves at depth d (the root is at depth 0), outside_* the overflow list 
+of the root */
+struct treeStats {
+  long internal_nodes;
+  long leaf_nodes;
+  long empty_leaves;
+  long bucket_leaves;
+  long bucket_locations;
+  long list_entries;
+  long outside_locations;
+  long outside_points;
+  int max_list_length;
+  int max_depth;
+  long depth_histogram[STATS_MAX_DEPTH + 1];
+  long node_bytes;
+  long rectangle_bytes;
+  long list_bytes;
+  long data_point_bytes;
+  long record_bytes;
+  long records;
+  long distinct_strings;
+  double root_area[4];
+};
+
+#ifdef QUADTREE_STATS
+extern queryStats_t query_stats;
+#define STATS_INC(field) (query_stats.field ++)
+#define STATS_ADD(field, n) (query_stats.field += (n))
+#define STATS_ALLOC() (query_stats.allocations ++)
+#define STATS_ENTER() do { query_stats.nodes_visited ++; query_stats.depth ++; \
+  if (query_stats.depth > query_stats.max_depth) { query_stats.max_depth = query_stats.depth; } } while (0)
+#define STATS_LEAVE() (query_stats.depth --)
+#define STATS_DEPTH(node_depth) do { query_stats.depth = (node_depth); \
+  if (query_stats.depth > query_stats.max_depth) { query_stats.max_depth = query_stats.depth; } } while (0)
+#define STATS_LEAF(list_length) do { query_stats.leaves_tested ++; query_stats.depth_sum += query_stats.depth; \
+  if ((list_length) > query_stats.max_coincident) { query_stats.max_coincident = (list_length); } } while (0)
+#else
+#define STATS_INC(field) ((void)0)
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_ALLOC() ((void)0)
+#define STATS_ENTER() ((void)0)
+#define STATS_LEAVE() ((void)0)
+#define STATS_DEPTH(node_depth) ((void)0)
+#define STATS_LEAF(list_length) ((void)0)
+#endif
+
+void reset_query_stats();
+void print_query_stats(FILE *output, char *label);
+void print_tree_stats(FILE *output, treeStats_t *stats);
+
+#endif
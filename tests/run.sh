@@ -0,0 +1,111 @@
+#!/bin/sh
+# runs the fixtures of tests/ against the dict3 and dict4 in the directory $1 (see `make check`) and compares the
+# output files and stdout with testN.sK.out and testN.sK.stdout.out, ignoring trailing whitespace. with
+# --fixed-point (see `make check-fixed-point`) only the output files are compared, the ones of --join and
+# --unordered without their order, as the search paths and the order the pairs are found in can differ
+bin=$1
+mode=$2
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failed=0
+
+# same name testN.sK: compare the files written by the last run with the fixture
+compare() {
+  name=$1
+  unordered=$2
+  if [ "$mode" = --fixed-point ]; then
+    if [ -n "$unordered" ]; then
+      sed 's/ *$//' "$tmp/out" | sort > "$tmp/sorted"
+      sed 's/ *$//' "tests/$name.out" | sort | diff -q - "$tmp/sorted" > /dev/null || { echo "$name: output differs"; failed=1; }
+      return
+    fi
+  elif ! diff -qZ "$tmp/stdout" "tests/$name.stdout.out" > /dev/null; then
+    echo "$name: stdout differs"
+    failed=1
+  fi
+  diff -qZ "$tmp/out" "tests/$name.out" > /dev/null || { echo "$name: output differs"; failed=1; }
+}
+
+# run testN.sK dataset [arguments]: the queries of testN.sK.in on tests/dataset_<dataset>.csv
+run() {
+  name=$1
+  dataset=$2
+  shift 2
+  stage=${name##*.s}
+  "$bin/dict$stage" "$stage" "tests/dataset_$dataset.csv" "$tmp/out" "$@" < "tests/$name.in" > "$tmp/stdout" ||
+  { echo "$name: exit status $?"; failed=1; return; }
+  compare "$name"
+}
+
+run test1.s3 1 144.969 -37.7975 144.971 -37.7955
+run test3.s3 1 144.968 -37.797 144.977 -37.79
+run test5.s3 2 144.968 -37.797 144.977 -37.79
+run test6.s3 20 144.952 -37.81 144.978 -37.79
+run test7.s3 100 144.9538 -37.812 144.9792 -37.784
+run test8.s3 1000 144.9375 -37.8750 145.0000 -37.6875
+run test9.s4 1 144.969 -37.7975 144.971 -37.7955
+run test11.s4 2 144.968 -37.797 144.977 -37.79
+run test12.s4 20 144.952 -37.81 144.978 -37.79
+run test13.s4 100 144.9375 -37.8750 145.0000 -37.6875
+run test14.s4 1000 144.9375 -37.8750 145.0000 -37.6875
+run test15.s3 cluster 144.969 -37.7975 144.971 -37.7955 --max-depth 12
+run test16.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --asset-type "Road Footway" --max-grade 20
+run test17.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --aggregate
+run test18.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --limit 5 --cursor 20000
+run test20.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --shards 3
+run test21.s4 1000 144.95 -37.82 144.97 -37.80
+run test23.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --polygon tests/wards.csv
+run test24.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --sample-count 16
+run test26.s3 1000 144.9375 -37.8750 145.0000 -37.6875
+run test28.s3 1000 144.9375 -37.8750 145.0000 -37.6875 --batch
+run test29.s3 1000 144.9375 -37.8750 145.0000 -37.6875 --binary-queries
+
+# the memory placement options do not change the output
+run test8.s3 1000 144.9375 -37.8750 145.0000 -37.6875 --huge-pages --interleave --pin
+run test17.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --aggregate --huge-pages --interleave --pin
+run test20.s4 1000 144.9375 -37.8750 145.0000 -37.6875 --shards 3 --huge-pages --interleave --pin
+
+# the pairs of --join and the footpaths of --unordered are written in the order they are found
+"$bin/dict4" 4 tests/dataset_1000.csv "$tmp/out" 144.9375 -37.8750 145.0000 -37.6875 --join tests/stops.csv \
+--distance 0.0008 < tests/test19.s4.in > "$tmp/stdout" && compare test19.s4 unordered || { echo "test19.s4: failed"; failed=1; }
+"$bin/dict4" 4 tests/dataset_1000.csv "$tmp/out" 144.9375 -37.8750 145.0000 -37.6875 --unordered \
+< tests/test22.s4.in > "$tmp/stdout" && compare test22.s4 unordered || { echo "test22.s4: failed"; failed=1; }
+
+# the index is written by a first run and read by a second one, whose output file is also the one of the csv file
+"$bin/dict4" 4 tests/dataset_1000.csv /dev/null 144.9375 -37.8750 145.0000 -37.6875 --write-index "$tmp/index.qtx" \
+< /dev/null > /dev/null && "$bin/dict4" 4 "$tmp/index.qtx" "$tmp/out" 144.9375 -37.8750 145.0000 -37.6875 --index \
+< tests/test25.s4.in > "$tmp/stdout" && compare test25.s4 || { echo "test25.s4: failed"; failed=1; }
+"$bin/dict4" 4 tests/dataset_1000.csv "$tmp/out" 144.9375 -37.8750 145.0000 -37.6875 < tests/test25.s4.in > /dev/null &&
+diff -qZ "$tmp/out" tests/test25.s4.out > /dev/null || { echo "test25.s4: output differs from the csv file"; failed=1; }
+
+# the tree report of --stats goes to stderr, its sizes depend on the build
+"$bin/dict3" 3 tests/dataset_degenerate.csv "$tmp/out" 144.969 -37.7975 144.971 -37.7955 --max-depth 24 --stats \
+< tests/test27.s3.in > "$tmp/stdout" 2> "$tmp/stderr" && compare test27.s3 || { echo "test27.s3: failed"; failed=1; }
+if [ "$mode" != --fixed-point ] && ! diff -qZ "$tmp/stderr" tests/test27.s3.stats.out > /dev/null; then
+  echo "test27.s3: stats differ"
+  failed=1
+fi
+
+# --follow: dataset_1000.csv is appended to the input file in three parts, each one once the answer to the query
+# before it has been flushed
+follow() {
+  while [ "$(wc -l < "$tmp/stdout")" -lt $1 ]; do
+    kill -0 $pid 2> /dev/null || return 1
+    sleep 0.1
+  done
+}
+head -n 401 tests/dataset_1000.csv > "$tmp/feed.csv"
+mkfifo "$tmp/queries"
+"$bin/dict4" 4 "$tmp/feed.csv" "$tmp/out" 144.9375 -37.8750 145.0000 -37.6875 --follow < "$tmp/queries" > "$tmp/stdout" &
+pid=$!
+exec 3> "$tmp/queries"
+sed -n 1p tests/test30.s4.in >&3
+follow 1 && sed -n 402,701p tests/dataset_1000.csv >> "$tmp/feed.csv"
+sed -n 2p tests/test30.s4.in >&3
+follow 2 && sed -n '702,$p' tests/dataset_1000.csv >> "$tmp/feed.csv"
+sed -n 3p tests/test30.s4.in >&3
+exec 3>&-
+wait $pid && compare test30.s4 || { echo "test30.s4: failed"; failed=1; }
+
+[ $failed = 0 ] && echo "all fixtures passed"
+exit $failed